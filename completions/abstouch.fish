@@ -1,5 +1,5 @@
 #!/usr/bin/env fish
-set -l commands help start stop setup calibrate config
+set -l commands help start stop stats status pause resume reload profile setup calibrate config record replay
 complete -c abstouch -f
 
 complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
@@ -8,12 +8,28 @@ complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
     -a 'start' -d 'Starts the abstouch input client.'
 complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
     -a 'stop' -d 'Stops the abstouch input client running as daemon.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'stats' -d 'Shows the latency statistics of the abstouch input client.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'status' -d 'Shows the state of the running abstouch input client.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'pause' -d 'Gives the touchpad back until the input client is resumed.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'resume' -d 'Resumes the paused abstouch input client.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'reload' -d 'Reloads the configuration of the running input client.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'profile' -d 'Switches the running input client to another configuration.'
 complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
     -a 'setup' -d 'Runs the abstouch setup.'
 complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
     -a 'calibrate' -d 'Calibrates the abstouch input client.'
 complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
     -a 'config' -d 'Changes or shows the abstouch configuration interactively.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'record' -d 'Records the events of the touchpad into a file.'
+complete -c abstouch -n "not __fish_seen_subcommand_from $commands" \
+    -a 'replay' -d 'Replays the recorded events to the output.'
 
 complete -c abstouch -n '__fish_seen_subcommand_from start' \
     -a '--foreground' -d 'Runs the client on foreground instead of background.'
@@ -22,3 +38,11 @@ complete -c abstouch -n '__fish_seen_subcommand_from start' \
 
 complete -c abstouch -n '__fish_seen_subcommand_from calibrate' \
     -a '--no-visual' -d 'Disables the visualization while calibrating.'
+complete -c abstouch -n '__fish_seen_subcommand_from calibrate' \
+    -a '--corners' -d 'Calibrates by touching the four corners of the screen.'
+complete -c abstouch -n '__fish_seen_subcommand_from calibrate' \
+    -a '--grid' -d 'Calibrates the correction table by touching a grid of points.'
+
+complete -c abstouch -n '__fish_seen_subcommand_from record replay' -F
+complete -c abstouch -n '__fish_seen_subcommand_from replay' \
+    -a '--fast' -d 'Replays as fast as possible instead of the original timing.'
@@ -24,6 +24,9 @@
 
 #include "linux/event.h"
 #include "linux/client.h"
+#include "linux/stats.h"
+#include "linux/record.h"
+#include "linux/control.h"
 
 #include "config.h"
 #include "print.h"
@@ -34,6 +37,9 @@
 static int verbose = 1;
 static int daemon = 1;
 static int visual = 1;
+static int fast = 0;
+static int corners = 0;
+static int grid = 0;
 
 /*
  * Commands with the given name.
@@ -41,7 +47,15 @@ static int visual = 1;
 static int setup(void);
 static int start(void);
 static int stop(void);
-static int calibrate(void);
+static int stats(void);
+static int status(void);
+static int pause_client(void);
+static int resume_client(void);
+static int reload(void);
+static int profile(char **args, size_t args_size);
+static int record(char **args, size_t args_size);
+static int replay(char **args, size_t args_size);
+static int calibrate(char **args, size_t args_size);
 static int config(void);
 
 int main(int argc, char **argv)
@@ -99,14 +113,25 @@ int main(int argc, char **argv)
         LOGLN("help => Shows this text.");
         LOGLN("start => Starts the abstouch-nux input client.");
         LOGLN("stop => Stops the abstouch-nux input client running as daemon.");
+        LOGLN("stats => Shows the latency statistics of the abstouch-nux input client.");
+        LOGLN("status => Shows the state of the running abstouch-nux input client.");
+        LOGLN("pause => Gives the touchpad back until the input client is resumed.");
+        LOGLN("resume => Resumes the paused abstouch-nux input client.");
+        LOGLN("reload => Reloads the configuration of the running input client.");
+        LOGLN("profile <name> [device] => Switches the running input client, or its <device>th device, to the configuration <name>.conf.");
         LOGLN("setup => Runs the abstouch-nux setup.");
-        LOGLN("calibrate => Calibrates the abstouch-nux input client.");
+        LOGLN("calibrate [profile] => Calibrates the abstouch-nux input client, or the device of <profile>.conf.");
         LOGLN("config => Changes or shows the abstouch-nux configuration interactively.");
+        LOGLN("record <file> => Records the events of the touchpad into the file.");
+        LOGLN("replay <file> => Replays the recorded events to the output.");
         printf("\n");
         PRINTLN("---===Options===---");
         LOGLN("-f,--foreground => Runs the client on foreground instead of background.");
         LOGLN("-q,--quiet => Disables the output with the client except errors.");
         LOGLN("--no-visual => Disables the visualization while calibrating.");
+        LOGLN("--corners => Calibrates by touching the four corners of the screen.");
+        LOGLN("--grid => Calibrates the correction table by touching a grid of points.");
+        LOGLN("--fast => Replays as fast as possible instead of the original timing.");
         printf("\n");
         PRINTLN("---=============---");
         return EXIT_SUCCESS;
@@ -119,6 +144,12 @@ int main(int argc, char **argv)
             verbose = 0;
         else if (!strcmp(options[i], "no-visual"))
             visual = 0;
+        else if (!strcmp(options[i], "fast"))
+            fast = 1;
+        else if (!strcmp(options[i], "corners"))
+            corners = 1;
+        else if (!strcmp(options[i], "grid"))
+            grid = 1;
     }
 
     if (!strcmp(command, "setup"))
@@ -127,10 +158,26 @@ int main(int argc, char **argv)
         return start();
     else if (!strcmp(command, "stop"))
         return stop();
+    else if (!strcmp(command, "stats"))
+        return stats();
+    else if (!strcmp(command, "status"))
+        return status();
+    else if (!strcmp(command, "pause"))
+        return pause_client();
+    else if (!strcmp(command, "resume"))
+        return resume_client();
+    else if (!strcmp(command, "reload"))
+        return reload();
+    else if (!strcmp(command, "profile"))
+        return profile(args, args_size);
     else if (!strcmp(command, "calibrate"))
-        return calibrate();
+        return calibrate(args, args_size);
     else if (!strcmp(command, "config"))
         return config();
+    else if (!strcmp(command, "record"))
+        return record(args, args_size);
+    else if (!strcmp(command, "replay"))
+        return replay(args, args_size);
 
     ERRLN("Unknown command: \x1b[;m%s", command);
     LOGLN("See: \x1b[;mabstouch help");
@@ -145,6 +192,7 @@ static int setup(void)
     EConfig config = CGetConfig();
     config.use_defaults = 1;
     CSetConfig(config);
+    CFreeConfig(&config);
 
     LOG("Would you like to calibrate now? => [Y/n] => ");
     char buf[256];
@@ -158,7 +206,7 @@ static int setup(void)
                 LOGLNCLEAR("Would you like to calibrate now? => [Y/n] => y");
             }
        
-            CCalibrate(visual);
+            CCalibrate("abstouch-nux", visual);
             break;
         }
 
@@ -186,12 +234,75 @@ static int stop(void)
     return result;
 }
 
-static int calibrate(void)
+static int stats(void)
 {
-    return CCalibrate(visual);
+    return LShowStats();
+}
+
+static int status(void)
+{
+    return LControlInputClient(CONTROL_STATUS, NULL, CONTROL_ALL_DEVICES, 1);
+}
+
+static int pause_client(void)
+{
+    return LControlInputClient(CONTROL_PAUSE, NULL, CONTROL_ALL_DEVICES, verbose);
+}
+
+static int resume_client(void)
+{
+    return LControlInputClient(CONTROL_RESUME, NULL, CONTROL_ALL_DEVICES, verbose);
+}
+
+static int reload(void)
+{
+    return LControlInputClient(CONTROL_RELOAD, NULL, CONTROL_ALL_DEVICES, verbose);
+}
+
+static int profile(char **args, size_t args_size)
+{
+    if (args_size < 1) {
+        ERRLN("No profile provided.");
+        LOGLN("See: \x1b[;mabstouch help");
+        return EXIT_FAILURE;
+    }
+
+    return LControlInputClient(CONTROL_PROFILE, args[0], args_size > 1 ? atoi(args[1]) : 0, verbose);
+}
+
+static int calibrate(char **args, size_t args_size)
+{
+    char *profile = args_size > 0 ? args[0] : "abstouch-nux";
+    if (corners)
+        return CCalibrateCorners(profile);
+    if (grid)
+        return CCalibrateGrid(profile);
+    return CCalibrate(profile, visual);
 }
 
 static int config(void)
 {
     return CConfigInteractive();
 }
+
+static int record(char **args, size_t args_size)
+{
+    if (args_size < 1) {
+        ERRLN("No file provided.");
+        LOGLN("See: \x1b[;mabstouch help");
+        return EXIT_FAILURE;
+    }
+
+    return LRecord(args[0], verbose);
+}
+
+static int replay(char **args, size_t args_size)
+{
+    if (args_size < 1) {
+        ERRLN("No file provided.");
+        LOGLN("See: \x1b[;mabstouch help");
+        return EXIT_FAILURE;
+    }
+
+    return LReplay(args[0], fast, verbose);
+}
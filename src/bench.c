@@ -0,0 +1,443 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "linux/pipeline.h"
+#include "linux/record.h"
+
+#include "config.h"
+#include "print.h"
+#include "transform.h"
+#include "filter.h"
+
+/*
+ * Options.
+ */
+static int compare = 0;
+static long frame_count = 10000;
+static long iterations = 100;
+static char *file = NULL;
+static char *filter = NULL;
+
+/*
+ * Allocation counter, only counts while `counting` is true.
+ */
+static int counting = 0;
+static unsigned long allocations = 0;
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    allocations += counting;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    allocations += counting;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    allocations += counting;
+    return __libc_realloc(ptr, size);
+}
+
+/*
+ * Events and frames that the benchmarks run on.
+ */
+static struct input_event *events;
+static size_t event_count = 0;
+static EFrame *frames;
+static size_t frames_len = 0;
+
+/*
+ * Sink that keeps the compiler from optimizing the mapping away.
+ */
+static volatile int sink;
+
+/*
+ * Appends an event to the benchmark events.
+ */
+static void push_event(uint64_t time_us, int type, int code, int value)
+{
+    struct input_event *ev = &events[event_count++];
+    ev->time.tv_sec = time_us / 1000000;
+    ev->time.tv_usec = time_us % 1000000;
+    ev->type = type;
+    ev->code = code;
+    ev->value = value;
+}
+
+/*
+ * Returns a deterministic noise from -`amplitude` to `amplitude`.
+ */
+static int noise(int amplitude)
+{
+    static uint32_t state = 1;
+    state = state * 1103515245 + 12345;
+    return (int) ((state >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+/*
+ * Generates `frame_count` frames at 1kHz of a finger circling on a 4096x4096 touchpad,
+ * with a few units of sensor jitter.
+ */
+static void synthesize(EConfig *config)
+{
+    events = malloc(frame_count * 4 * sizeof(struct input_event));
+    for (long i = 0; i < frame_count; i++) {
+        double angle = i * 0.001;
+        push_event(i * 1000, EV_ABS, ABS_X, 2048 + (int) (1800 * cos(angle)) + noise(3));
+        push_event(i * 1000, EV_ABS, ABS_Y, 2048 + (int) (1800 * sin(angle)) + noise(3));
+        push_event(i * 1000, EV_ABS, ABS_PRESSURE, 40 + i % 20);
+        push_event(i * 1000, EV_SYN, SYN_REPORT, 0);
+    }
+
+    config->x_min = 0, config->x_max = 4095;
+    config->y_min = 0, config->y_max = 4095;
+}
+
+/*
+ * Loads the events of the recording at `path`.
+ */
+static int load(EConfig *config, char *path)
+{
+    ERecording recording;
+    if (LOpenRecording(&recording, path))
+        return EXIT_FAILURE;
+
+    events = malloc(recording.count * sizeof(struct input_event));
+    uint64_t time_us = 0;
+    for (uint32_t i = 0; i < recording.count; i++) {
+        const ERecordEvent *record = &recording.events[i];
+        time_us += record->delta_us;
+        push_event(time_us, record->type, record->code, record->value);
+    }
+
+    config->x_min = recording.header->absinfo[ABS_X].minimum;
+    config->x_max = recording.header->absinfo[ABS_X].maximum;
+    config->y_min = recording.header->absinfo[ABS_Y].minimum;
+    config->y_max = recording.header->absinfo[ABS_Y].maximum;
+    LOGLN("Loaded \x1b[0;37m%zu\x1b[1;37m events of \x1b[0;37m%s\x1b[1;37m.", event_count, recording.header->name);
+    LCloseRecording(&recording);
+
+    if (config->x_max <= config->x_min || config->y_max <= config->y_min) {
+        ERRLN("The recording has no absolute axes.");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Runs the events through the whole pipeline, mapping every frame.
+ */
+static void bench_pipeline(EConfig *config, EOutput *output)
+{
+    EPipeline pipeline;
+    LPipelineInit(&pipeline, config, -1, output);
+
+    unsigned long total_frames = 0;
+    allocations = 0;
+    counting = 1;
+    uint64_t start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < event_count; j++) {
+            if (!LPipelineFeed(&pipeline, &events[j], 1))
+                continue;
+
+            LPipelineOutput(&pipeline);
+            total_frames++;
+        }
+    }
+    uint64_t elapsed = LStatsNow(CLOCK_MONOTONIC) - start;
+    counting = 0;
+
+    PRINTLN("---=====Pipeline=====---");
+    LOGLN("Events => \x1b[0;37m%lu\x1b[1;37m, frames => \x1b[0;37m%lu", (unsigned long) (event_count * iterations), total_frames);
+    LOGLN("Events per second => \x1b[0;37m%.0f", event_count * iterations / (elapsed / 1e9));
+    LOGLN("Time per frame => \x1b[0;37m%.1f\x1b[1;37mns", total_frames ? (double) elapsed / total_frames : 0.0);
+    LOGLN("Allocations => \x1b[0;37m%lu", allocations);
+}
+
+/*
+ * Collects the complete frames of the events for the mapping comparison.
+ */
+static void collect_frames(void)
+{
+    EFrameAssembler assembler;
+    LFrameInit(&assembler, -1);
+
+    frames = malloc(event_count * sizeof(EFrame));
+    for (size_t i = 0; i < event_count; i++) {
+        if (LFramePush(&assembler, &events[i]))
+            frames[frames_len++] = assembler.frame;
+    }
+}
+
+/*
+ * Returns the root mean square of the second difference of `count` positions in `values`,
+ * which is how much the positions shake around a smooth movement.
+ */
+static double jitter(const int *values, size_t count)
+{
+    double sum = 0;
+    for (size_t i = 2; i < count; i++) {
+        double d = values[i] - 2.0 * values[i - 1] + values[i - 2];
+        sum += d * d;
+    }
+    return count > 2 ? sqrt(sum / (count - 2)) : 0;
+}
+
+/*
+ * Runs the frames through the configured filter and reports the jitter against the lag.
+ */
+static void bench_filter(EConfig *config)
+{
+    EFilter f;
+    if (FInitFilter(&f, config)) {
+        ERRLN("Unknown filter: \x1b[;m%s", config->filter);
+        return;
+    }
+
+    int *raw = malloc(frames_len * sizeof(int));
+    int *filtered = malloc(frames_len * sizeof(int));
+    double deviation = 0;
+    uint64_t elapsed = 0;
+    for (size_t i = 0; i < frames_len; i++) {
+        int x = frames[i].x, y = frames[i].y;
+        uint64_t start = LStatsNow(CLOCK_MONOTONIC);
+        FApplyFilter(&f, frames[i].time.tv_sec + frames[i].time.tv_usec / 1e6, &x, &y);
+        elapsed += LStatsNow(CLOCK_MONOTONIC) - start;
+
+        raw[i] = frames[i].x;
+        filtered[i] = x;
+        deviation += hypot(x - frames[i].x, y - frames[i].y);
+    }
+
+    PRINTLN("---=====Filter=======---");
+    LOGLN("Filter => \x1b[;m%s", config->filter);
+    LOGLN("Jitter => raw \x1b[0;37m%.2f\x1b[1;37m, filtered \x1b[0;37m%.2f\x1b[1;37m units", jitter(raw, frames_len), jitter(filtered, frames_len));
+    LOGLN("Mean deviation from raw => \x1b[0;37m%.2f\x1b[1;37m units", deviation / frames_len);
+    LOGLN("Time per frame => \x1b[0;37m%.1f\x1b[1;37mns", (double) elapsed / frames_len);
+    free(raw);
+    free(filtered);
+}
+
+/*
+ * Compares the original per-event integer division mapping with the fixed-point transform.
+ * Returns false if they differ by more than a pixel.
+ */
+static int bench_compare(EConfig *config, EOutput *output)
+{
+    if (!frames_len)
+        return EXIT_SUCCESS;
+
+    /* The original mapping has no filter and orientation. */
+    EConfig plain = *config;
+    plain.filter = "none";
+    plain.orientation = 0;
+    plain.mirror = 0;
+    plain.homography = "none";
+    plain.correction = 0;
+    config = &plain;
+
+    int x_min = config->x_min, x_max = config->x_max;
+    int y_min = config->y_min, y_max = config->y_max;
+    int width = output->width, height = output->height;
+
+    uint64_t start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < frames_len; j++) {
+            sink = width * (frames[j].x - x_min) / (x_max - x_min);
+            sink = height * (frames[j].y - y_min) / (y_max - y_min);
+        }
+    }
+    uint64_t legacy = LStatsNow(CLOCK_MONOTONIC) - start;
+
+    EPipeline pipeline;
+    LPipelineInit(&pipeline, config, -1, output);
+    start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < frames_len; j++) {
+            EPoint point = TApplyTransform(&pipeline.transform, frames[j].x, frames[j].y);
+            sink = point.x;
+            sink = point.y;
+        }
+    }
+    uint64_t transform = LStatsNow(CLOCK_MONOTONIC) - start;
+
+    /* A keystone over the same area, the top edge a tenth narrower than the bottom one. */
+    double inset = (x_max - x_min) / 20.0;
+    double from[4][2] = {{x_min + inset, y_min}, {x_max - inset, y_min}, {x_max, y_max}, {x_min, y_max}};
+    double to[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    double h[9];
+    ETransform projective;
+    ERect screen = {0, 0, width, height};
+    TSolveHomography(from, to, h);
+    TBuildProjectiveTransform(&projective, h, screen, x_min, x_max, y_min, y_max);
+    start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < frames_len; j++) {
+            EPoint point = TApplyTransform(&projective, frames[j].x, frames[j].y);
+            sink = point.x;
+            sink = point.y;
+        }
+    }
+    uint64_t homography = LStatsNow(CLOCK_MONOTONIC) - start;
+
+    /* Corners taken by hand are a little off, that alone must not cost the division. */
+    double off = (x_max - x_min) / 10000.0;
+    double noisy[4][2] = {{x_min + off, y_min - off}, {x_max + off, y_min}, {x_max - off, y_max + off}, {x_min, y_max - off}};
+    ETransform affine;
+    if (TSolveHomography(noisy, to, h) || TBuildProjectiveTransform(&affine, h, screen, x_min, x_max, y_min, y_max)
+        || affine.projective) {
+        ERRLN("Noisy corners didn't take the affine mapping.");
+        return EXIT_FAILURE;
+    }
+
+    /* The affine mapping has to stay within its error of the homography, plus the rounding to a sub-pixel. */
+    double subpixel = 1 << TRANSFORM_SUBPIXEL_BITS, max_affine = 0;
+    for (size_t j = 0; j < frames_len; j++) {
+        double x = frames[j].x, y = frames[j].y, w = h[6] * x + h[7] * y + h[8];
+        EPoint point = TApplyTransform(&affine, frames[j].x, frames[j].y);
+        double error_x = fabs(point.x - (h[0] * x + h[1] * y + h[2]) / w * width * subpixel);
+        double error_y = fabs(point.y - (h[3] * x + h[4] * y + h[5]) / w * height * subpixel);
+        max_affine = fmax(max_affine, fmax(error_x, error_y) / subpixel);
+    }
+
+    /* A table that pulls the edges in, like a touchpad that is less linear there. */
+    static ECorrectionNode nodes[9 * 9];
+    ECorrectionHeader header = {.magic = CORRECTION_MAGIC, .version = CORRECTION_VERSION, .header_size = sizeof(header),
+        .columns = 9, .rows = 9, .x_min = x_min, .x_max = x_max, .y_min = y_min, .y_max = y_max};
+    for (int i = 0; i < 9 * 9; i++) {
+        double u = (i % 9) / 4.0 - 1, v = (i / 9) / 4.0 - 1;
+        nodes[i].dx = (int16_t) (-u * u * u * (x_max - x_min) / 50);
+        nodes[i].dy = (int16_t) (-v * v * v * (y_max - y_min) / 50);
+    }
+    ECorrection correction;
+    LCorrectionInit(&correction, &header, nodes);
+    start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < frames_len; j++) {
+            int x = frames[j].x, y = frames[j].y;
+            LCorrect(&correction, &x, &y);
+            EPoint point = TApplyTransform(&pipeline.transform, x, y);
+            sink = point.x;
+            sink = point.y;
+        }
+    }
+    uint64_t corrected = LStatsNow(CLOCK_MONOTONIC) - start;
+
+    start = LStatsNow(CLOCK_MONOTONIC);
+    for (long i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < frames_len; j++) {
+            pipeline.assembler.frame = frames[j];
+            LPipelineMap(&pipeline);
+        }
+    }
+    uint64_t current = LStatsNow(CLOCK_MONOTONIC) - start;
+
+    int max_error = 0;
+    for (size_t j = 0; j < frames_len; j++) {
+        pipeline.assembler.frame = frames[j];
+        LPipelineMap(&pipeline);
+        int error_x = abs(pipeline.cx - width * (frames[j].x - x_min) / (x_max - x_min));
+        int error_y = abs(pipeline.cy - height * (frames[j].y - y_min) / (y_max - y_min));
+        if (error_x > max_error) max_error = error_x;
+        if (error_y > max_error) max_error = error_y;
+    }
+
+    unsigned long total = frames_len * iterations;
+    PRINTLN("---=====Mapping======---");
+    LOGLN("Integer division => \x1b[0;37m%.2f\x1b[1;37mns per frame", (double) legacy / total);
+    LOGLN("Fixed-point transform => \x1b[0;37m%.2f\x1b[1;37mns per frame", (double) transform / total);
+    LOGLN("Projective transform => \x1b[0;37m%.2f\x1b[1;37mns per frame", (double) homography / total);
+    LOGLN("Grid correction and transform => \x1b[0;37m%.2f\x1b[1;37mns per frame", (double) corrected / total);
+    LOGLN("Pipeline output => \x1b[0;37m%.2f\x1b[1;37mns per frame", (double) current / total);
+    LOGLN("Maximum difference => \x1b[0;37m%d\x1b[1;37mpx", max_error);
+    LOGLN("Affine mapping of noisy corners => \x1b[0;37m%.3f\x1b[1;37mpx from the homography", max_affine);
+    return max_error > 1 || max_affine > TRANSFORM_AFFINE_ERROR + 1 / subpixel ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--compare"))
+            compare = 1;
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+            frame_count = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            iterations = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--help")) {
+            PRINTLN("---===abstouch-bench===---");
+            LOGLN("abstouch-bench [\x1b[;moptions] [\x1b[;mrecording]");
+            LOGLN("--frames <n> => Count of synthetic frames when there is no recording.");
+            LOGLN("--iterations <n> => Count of times the events are run.");
+            LOGLN("--compare => Compares the integer division mapping with the fixed-point transform.");
+            LOGLN("--filter <type> => Measures the jitter and lag of the filter, the parameters are from the configuration.");
+            return EXIT_SUCCESS;
+        } else
+            file = argv[i];
+    }
+
+    if (frame_count < 1 || iterations < 1) {
+        ERRLN("Frames and iterations must be positive.");
+        return EXIT_FAILURE;
+    }
+
+    /* Filter parameters are taken from the configuration so they can be tuned with recordings. */
+    EConfig config = CGetConfig();
+    strcpy(config.output, "null");
+    config.orientation = 0;
+    config.mirror = 0;
+    config.correction = 0;
+    if (filter != NULL)
+        snprintf(config.filter, CONFIG_VALUE_SIZE, "%s", filter);
+    if (file != NULL) {
+        if (load(&config, file)) {
+            CFreeConfig(&config);
+            return EXIT_FAILURE;
+        }
+    } else
+        synthesize(&config);
+
+    /* A common screen size, the null output has no display to take it from. */
+    EOutput output;
+    LOpenOutput(&output, OUTPUT_NULL, NULL, 0, 0);
+    output.width = 1920;
+    output.height = 1080;
+
+    bench_pipeline(&config, &output);
+    collect_frames();
+    if (filter != NULL)
+        bench_filter(&config);
+    int status = compare ? bench_compare(&config, &output) : EXIT_SUCCESS;
+    CFreeConfig(&config);
+    return status;
+}
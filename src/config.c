@@ -70,7 +70,9 @@ char *CGetConfigDir(void)
 int CConfigExists(char *config)
 {
     char path[4096];
-    snprintf(path, 4096, "%s/%s.conf", CGetConfigDir(), config);
+    char *dir = CGetConfigDir();
+    snprintf(path, 4096, "%s/%s.conf", dir, config);
+    free(dir);
     return access(path, F_OK) == 0;
 }
 
@@ -79,34 +81,91 @@ int CConfigExists(char *config)
  */
 EConfig CGetConfig(void)
 {
-    EConfig config = {.event = 0, .event_name = "",
+    return CGetProfile("abstouch-nux");
+}
+
+/*
+ * Sets `strings` to the string values of `config`, other than its profile.
+ */
+static void config_strings(EConfig *config, char **strings[CONFIG_STRING_COUNT])
+{
+    char **fields[CONFIG_STRING_COUNT] = {
+        &config->devices, &config->event_name, &config->display, &config->output, &config->target, &config->contact,
+        &config->homography, &config->filter, &config->press, &config->press_code, &config->realtime_policy
+    };
+    memcpy(strings, fields, sizeof(fields));
+}
+
+/*
+ * Returns the configuration saved in the config file of `profile`.
+ */
+EConfig CGetProfile(char *profile)
+{
+    EConfig config = {.profile = profile, .devices = "abstouch-nux", .threads = 0,
+        .event = 0, .event_name = "",
         .display = ":0", .screen = 0,
-        .use_defaults = 0,
+        .output = "x", .target = "root", .contact = "first",
+        .use_defaults = 0, .grab = 1,
         .x_min = 0, .x_max = 0,
         .y_min = 0, .y_max = 0,
+        .calibrate_low = 0.5, .calibrate_high = 99.5, .homography = "none",
+        .correction = 0, .correction_columns = 5, .correction_rows = 5,
+        .orientation = 0, .mirror = 0,
+        .filter = "none",
+        .filter_min_cutoff = 1.0, .filter_beta = 0.007, .filter_d_cutoff = 1.0,
+        .filter_process_noise = 1e9, .filter_measurement_noise = 4.0, .filter_predict_ms = 8.0,
+        .palm = 0, .palm_size = 0.5, .palm_pressure = 0.8, .palm_hysteresis = 0.1, .palm_settle_ms = 30,
+        .press = "none", .press_code = "BTN_LEFT", .press_pressure = 0.3, .press_hysteresis = 0.1,
+        .press_tap_ms = 150, .press_tap_move = 0.02,
+        .realtime = 0, .realtime_policy = "fifo", .realtime_priority = 50, .cpu = -1,
         .error = 0};
-    if (!CConfigExists("abstouch-nux")) {
+
+    /* Every string gets a buffer of its own, so it can be edited and freed like the ones that are read. */
+    char **strings[CONFIG_STRING_COUNT];
+    config_strings(&config, strings);
+    for (int i = 0; i < CONFIG_STRING_COUNT; i++) {
+        char *value = malloc(CONFIG_VALUE_SIZE);
+        strcpy(value, *strings[i]);
+        *strings[i] = value;
+    }
+    strcpy((config.profile = malloc(strlen(profile) + 1)), profile);
+
+    if (strchr(profile, '/') != NULL || !CConfigExists(profile)) {
         config.error = 1;
         return config;
     }
 
     char path[4096];
-    snprintf(path, 4096 , "%s/abstouch-nux.conf", CGetConfigDir());
-    char key[256], val[256];
+    char *dir = CGetConfigDir();
+    snprintf(path, 4096 , "%s/%s.conf", dir, profile);
+    free(dir);
+    char key[256], val[CONFIG_VALUE_SIZE];
     char *p;
 
     FILE *f = fopen(path, "r");
     while (fscanf(f, "%255[^=]=%255[^\n]%*c", key, val) == 2) {
-        if (!strcmp(key, "event"))
+        if (!strcmp(key, "devices"))
+            strcpy(config.devices, val);
+        else if (!strcmp(key, "threads"))
+            config.threads = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "event"))
             config.event = (int) strtol(val, &p, 10);
         else if (!strcmp(key, "event_name"))
-            strcpy((config.event_name = malloc(sizeof(val))), val);
+            strcpy(config.event_name, val);
         else if (!strcmp(key, "display")) 
-            strcpy((config.display = malloc(sizeof(val))), val);
+            strcpy(config.display, val);
         else if (!strcmp(key, "screen"))
             config.screen = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "output"))
+            strcpy(config.output, val);
+        else if (!strcmp(key, "target"))
+            strcpy(config.target, val);
+        else if (!strcmp(key, "contact"))
+            strcpy(config.contact, val);
         else if (!strcmp(key, "use_defaults"))
             config.use_defaults = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "grab"))
+            config.grab = (int) strtol(val, &p, 10);
         else if (!strcmp(key, "x_min"))
             config.x_min = (int) strtol(val, &p, 10);
         else if (!strcmp(key, "x_max"))
@@ -115,6 +174,66 @@ EConfig CGetConfig(void)
             config.y_min = (int) strtol(val, &p, 10);
         else if (!strcmp(key, "y_max"))
             config.y_max = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "calibrate_low"))
+            config.calibrate_low = strtod(val, &p);
+        else if (!strcmp(key, "calibrate_high"))
+            config.calibrate_high = strtod(val, &p);
+        else if (!strcmp(key, "homography"))
+            strcpy(config.homography, val);
+        else if (!strcmp(key, "correction"))
+            config.correction = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "correction_columns"))
+            config.correction_columns = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "correction_rows"))
+            config.correction_rows = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "orientation"))
+            config.orientation = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "mirror"))
+            config.mirror = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "filter"))
+            strcpy(config.filter, val);
+        else if (!strcmp(key, "filter_min_cutoff"))
+            config.filter_min_cutoff = strtod(val, &p);
+        else if (!strcmp(key, "filter_beta"))
+            config.filter_beta = strtod(val, &p);
+        else if (!strcmp(key, "filter_d_cutoff"))
+            config.filter_d_cutoff = strtod(val, &p);
+        else if (!strcmp(key, "filter_process_noise"))
+            config.filter_process_noise = strtod(val, &p);
+        else if (!strcmp(key, "filter_measurement_noise"))
+            config.filter_measurement_noise = strtod(val, &p);
+        else if (!strcmp(key, "filter_predict_ms"))
+            config.filter_predict_ms = strtod(val, &p);
+        else if (!strcmp(key, "palm"))
+            config.palm = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "palm_size"))
+            config.palm_size = strtod(val, &p);
+        else if (!strcmp(key, "palm_pressure"))
+            config.palm_pressure = strtod(val, &p);
+        else if (!strcmp(key, "palm_hysteresis"))
+            config.palm_hysteresis = strtod(val, &p);
+        else if (!strcmp(key, "palm_settle_ms"))
+            config.palm_settle_ms = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "press"))
+            strcpy(config.press, val);
+        else if (!strcmp(key, "press_code"))
+            strcpy(config.press_code, val);
+        else if (!strcmp(key, "press_pressure"))
+            config.press_pressure = strtod(val, &p);
+        else if (!strcmp(key, "press_hysteresis"))
+            config.press_hysteresis = strtod(val, &p);
+        else if (!strcmp(key, "press_tap_ms"))
+            config.press_tap_ms = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "press_tap_move"))
+            config.press_tap_move = strtod(val, &p);
+        else if (!strcmp(key, "realtime"))
+            config.realtime = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "realtime_policy"))
+            strcpy(config.realtime_policy, val);
+        else if (!strcmp(key, "realtime_priority"))
+            config.realtime_priority = (int) strtol(val, &p, 10);
+        else if (!strcmp(key, "cpu"))
+            config.cpu = (int) strtol(val, &p, 10);
     }
     fclose(f);
 
@@ -123,23 +242,76 @@ EConfig CGetConfig(void)
 }
 
 /*
- * Saves the configuration to the config file.
+ * Frees the strings of the `config` returned by `CGetProfile`.
+ */
+void CFreeConfig(EConfig *config)
+{
+    char **strings[CONFIG_STRING_COUNT];
+    config_strings(config, strings);
+    for (int i = 0; i < CONFIG_STRING_COUNT; i++) {
+        free(*strings[i]);
+        *strings[i] = NULL;
+    }
+    free(config->profile);
+    config->profile = NULL;
+}
+
+/*
+ * Saves the configuration to the config file of its profile.
  */
 int CSetConfig(EConfig config)
 {
     char path[4096];
-    snprintf(path, 4096, "%s/abstouch-nux.conf", CGetConfigDir());
+    char *dir = CGetConfigDir();
+    snprintf(path, 4096, "%s/%s.conf", dir, config.profile != NULL ? config.profile : "abstouch-nux");
+    free(dir);
 
     FILE *f = fopen(path, "w");
+    fprintf(f, "devices=%s\n", config.devices);
+    fprintf(f, "threads=%d\n", config.threads);
     fprintf(f, "event=%d\n", config.event);
     fprintf(f, "event_name=%s\n", config.event_name);
     fprintf(f, "display=%s\n", config.display);
     fprintf(f, "screen=%d\n", config.screen);
+    fprintf(f, "output=%s\n", config.output);
+    fprintf(f, "target=%s\n", config.target);
+    fprintf(f, "contact=%s\n", config.contact);
     fprintf(f, "use_defaults=%d\n", config.use_defaults);
+    fprintf(f, "grab=%d\n", config.grab);
     fprintf(f, "x_min=%d\n", config.x_min);
     fprintf(f, "x_max=%d\n", config.x_max);
     fprintf(f, "y_min=%d\n", config.y_min);
     fprintf(f, "y_max=%d\n", config.y_max);
+    fprintf(f, "calibrate_low=%g\n", config.calibrate_low);
+    fprintf(f, "calibrate_high=%g\n", config.calibrate_high);
+    fprintf(f, "homography=%s\n", config.homography);
+    fprintf(f, "correction=%d\n", config.correction);
+    fprintf(f, "correction_columns=%d\n", config.correction_columns);
+    fprintf(f, "correction_rows=%d\n", config.correction_rows);
+    fprintf(f, "orientation=%d\n", config.orientation);
+    fprintf(f, "mirror=%d\n", config.mirror);
+    fprintf(f, "filter=%s\n", config.filter);
+    fprintf(f, "filter_min_cutoff=%g\n", config.filter_min_cutoff);
+    fprintf(f, "filter_beta=%g\n", config.filter_beta);
+    fprintf(f, "filter_d_cutoff=%g\n", config.filter_d_cutoff);
+    fprintf(f, "filter_process_noise=%g\n", config.filter_process_noise);
+    fprintf(f, "filter_measurement_noise=%g\n", config.filter_measurement_noise);
+    fprintf(f, "filter_predict_ms=%g\n", config.filter_predict_ms);
+    fprintf(f, "palm=%d\n", config.palm);
+    fprintf(f, "palm_size=%g\n", config.palm_size);
+    fprintf(f, "palm_pressure=%g\n", config.palm_pressure);
+    fprintf(f, "palm_hysteresis=%g\n", config.palm_hysteresis);
+    fprintf(f, "palm_settle_ms=%d\n", config.palm_settle_ms);
+    fprintf(f, "press=%s\n", config.press);
+    fprintf(f, "press_code=%s\n", config.press_code);
+    fprintf(f, "press_pressure=%g\n", config.press_pressure);
+    fprintf(f, "press_hysteresis=%g\n", config.press_hysteresis);
+    fprintf(f, "press_tap_ms=%d\n", config.press_tap_ms);
+    fprintf(f, "press_tap_move=%g\n", config.press_tap_move);
+    fprintf(f, "realtime=%d\n", config.realtime);
+    fprintf(f, "realtime_policy=%s\n", config.realtime_policy);
+    fprintf(f, "realtime_priority=%d\n", config.realtime_priority);
+    fprintf(f, "cpu=%d\n", config.cpu);
     fclose(f);
     return EXIT_SUCCESS;
 }
@@ -161,11 +333,27 @@ int CSetDisplayInteractive(void)
 }
 
 /*
- * Calibrate the touchpad and set the configuration about limits.
+ * Calibrate the touchpad of `profile` and set the configuration about limits.
  */
-int CCalibrate(int visual)
+int CCalibrate(char *profile, int visual)
 {
-    return LCalibrate(visual);
+    return LCalibrate(profile, visual);
+}
+
+/*
+ * Calibrate the touchpad of `profile` with four touched corners and set the homography.
+ */
+int CCalibrateCorners(char *profile)
+{
+    return LCalibrateCorners(profile);
+}
+
+/*
+ * Calibrate the touchpad of `profile` with a grid of touched points and write its correction table.
+ */
+int CCalibrateGrid(char *profile)
+{
+    return LCalibrateGrid(profile);
 }
 
 /*
@@ -178,20 +366,56 @@ int CConfigInteractive()
         CSetConfig(config);
     
     /* Total lines and the key count in the configuration menu to use in calculations. */
-    int lines = 13;
-    int key_count = 9;
+    int lines = 49;
+    int key_count = 45;
 
     /* 2D array that holds information about the config keys. */
     EConfigKey keys[] = {
+        {.pointer_str = &config.devices, .type = 1},
+        {.pointer_int = &config.threads, .type = 2},
         {.pointer_int = &config.event, .type = 0},
         {.pointer_str = &config.event_name, .type = 1},
         {.pointer_str = &config.display, .type = 1},
         {.pointer_int = &config.screen, .type = 0},
+        {.pointer_str = &config.output, .type = 1},
+        {.pointer_str = &config.target, .type = 1},
+        {.pointer_str = &config.contact, .type = 1},
         {.pointer_int = &config.use_defaults, .type = 2},
+        {.pointer_int = &config.grab, .type = 2},
         {.pointer_int = &config.x_min, .type = 0},
         {.pointer_int = &config.x_max, .type = 0},
         {.pointer_int = &config.y_min, .type = 0},
-        {.pointer_int = &config.y_max, .type = 0}
+        {.pointer_int = &config.y_max, .type = 0},
+        {.pointer_double = &config.calibrate_low, .type = 3},
+        {.pointer_double = &config.calibrate_high, .type = 3},
+        {.pointer_str = &config.homography, .type = 1},
+        {.pointer_int = &config.correction, .type = 2},
+        {.pointer_int = &config.correction_columns, .type = 0},
+        {.pointer_int = &config.correction_rows, .type = 0},
+        {.pointer_int = &config.orientation, .type = 0},
+        {.pointer_int = &config.mirror, .type = 2},
+        {.pointer_str = &config.filter, .type = 1},
+        {.pointer_double = &config.filter_min_cutoff, .type = 3},
+        {.pointer_double = &config.filter_beta, .type = 3},
+        {.pointer_double = &config.filter_d_cutoff, .type = 3},
+        {.pointer_double = &config.filter_process_noise, .type = 3},
+        {.pointer_double = &config.filter_measurement_noise, .type = 3},
+        {.pointer_double = &config.filter_predict_ms, .type = 3},
+        {.pointer_int = &config.palm, .type = 2},
+        {.pointer_double = &config.palm_size, .type = 3},
+        {.pointer_double = &config.palm_pressure, .type = 3},
+        {.pointer_double = &config.palm_hysteresis, .type = 3},
+        {.pointer_int = &config.palm_settle_ms, .type = 0},
+        {.pointer_str = &config.press, .type = 1},
+        {.pointer_str = &config.press_code, .type = 1},
+        {.pointer_double = &config.press_pressure, .type = 3},
+        {.pointer_double = &config.press_hysteresis, .type = 3},
+        {.pointer_int = &config.press_tap_ms, .type = 0},
+        {.pointer_double = &config.press_tap_move, .type = 3},
+        {.pointer_int = &config.realtime, .type = 2},
+        {.pointer_str = &config.realtime_policy, .type = 1},
+        {.pointer_int = &config.realtime_priority, .type = 0},
+        {.pointer_int = &config.cpu, .type = 0}
     };
 
     PRINTLN("---===abstouch-nux=Configuration===---");
@@ -206,15 +430,51 @@ int CConfigInteractive()
     signal(SIGINT, signal_handler);
     while (!stop) {
         CUP(lines);
+        LOGLNCLEAR("Devices = \"\x1b[0;37m%s\"", config.devices);
+        LOGLNCLEAR("Threads = \x1b[0;37m%s", config.threads ? "Yes" : "No");
         LOGLNCLEAR("Event = \x1b[0;37m%d", config.event);
         LOGLNCLEAR("Event Name = \"\x1b[0;37m%s\"", config.event_name);
         LOGLNCLEAR("Display = \"\x1b[0;37m%s\"", config.display);
         LOGLNCLEAR("Screen = \x1b[0;37m%d", config.screen);
+        LOGLNCLEAR("Output = \"\x1b[0;37m%s\"", config.output);
+        LOGLNCLEAR("Target = \"\x1b[0;37m%s\"", config.target);
+        LOGLNCLEAR("Contact = \"\x1b[0;37m%s\"", config.contact);
         LOGLNCLEAR("Use Defaults = \x1b[0;37m%s", config.use_defaults ? "Yes" : "No");
+        LOGLNCLEAR("Grab = \x1b[0;37m%s", config.grab ? "Yes" : "No");
         LOGLNCLEAR("Min X = \x1b[0;37m%d", config.x_min);
         LOGLNCLEAR("Max X = \x1b[0;37m%d", config.x_max);
         LOGLNCLEAR("Min Y = \x1b[0;37m%d", config.y_min);
         LOGLNCLEAR("Max Y = \x1b[0;37m%d", config.y_max);
+        LOGLNCLEAR("Calibrate Low = \x1b[0;37m%g\x1b[1;37m%%", config.calibrate_low);
+        LOGLNCLEAR("Calibrate High = \x1b[0;37m%g\x1b[1;37m%%", config.calibrate_high);
+        LOGLNCLEAR("Homography = \"\x1b[0;37m%s\"", config.homography);
+        LOGLNCLEAR("Correction = \x1b[0;37m%s", config.correction ? "Yes" : "No");
+        LOGLNCLEAR("Correction Columns = \x1b[0;37m%d", config.correction_columns);
+        LOGLNCLEAR("Correction Rows = \x1b[0;37m%d", config.correction_rows);
+        LOGLNCLEAR("Orientation = \x1b[0;37m%d", config.orientation);
+        LOGLNCLEAR("Mirror = \x1b[0;37m%s", config.mirror ? "Yes" : "No");
+        LOGLNCLEAR("Filter = \"\x1b[0;37m%s\"", config.filter);
+        LOGLNCLEAR("Filter Min Cutoff = \x1b[0;37m%g", config.filter_min_cutoff);
+        LOGLNCLEAR("Filter Beta = \x1b[0;37m%g", config.filter_beta);
+        LOGLNCLEAR("Filter Derivative Cutoff = \x1b[0;37m%g", config.filter_d_cutoff);
+        LOGLNCLEAR("Filter Process Noise = \x1b[0;37m%g", config.filter_process_noise);
+        LOGLNCLEAR("Filter Measurement Noise = \x1b[0;37m%g", config.filter_measurement_noise);
+        LOGLNCLEAR("Filter Prediction = \x1b[0;37m%g\x1b[1;37mms", config.filter_predict_ms);
+        LOGLNCLEAR("Palm Rejection = \x1b[0;37m%s", config.palm ? "Yes" : "No");
+        LOGLNCLEAR("Palm Size = \x1b[0;37m%g", config.palm_size);
+        LOGLNCLEAR("Palm Pressure = \x1b[0;37m%g", config.palm_pressure);
+        LOGLNCLEAR("Palm Hysteresis = \x1b[0;37m%g", config.palm_hysteresis);
+        LOGLNCLEAR("Palm Settle = \x1b[0;37m%d\x1b[1;37mms", config.palm_settle_ms);
+        LOGLNCLEAR("Press = \"\x1b[0;37m%s\"", config.press);
+        LOGLNCLEAR("Press Code = \"\x1b[0;37m%s\"", config.press_code);
+        LOGLNCLEAR("Press Pressure = \x1b[0;37m%g", config.press_pressure);
+        LOGLNCLEAR("Press Hysteresis = \x1b[0;37m%g", config.press_hysteresis);
+        LOGLNCLEAR("Press Tap Time = \x1b[0;37m%d\x1b[1;37mms", config.press_tap_ms);
+        LOGLNCLEAR("Press Tap Move = \x1b[0;37m%g", config.press_tap_move);
+        LOGLNCLEAR("Realtime = \x1b[0;37m%s", config.realtime ? "Yes" : "No");
+        LOGLNCLEAR("Realtime Policy = \"\x1b[0;37m%s\"", config.realtime_policy);
+        LOGLNCLEAR("Realtime Priority = \x1b[0;37m%d", config.realtime_priority);
+        LOGLNCLEAR("CPU = \x1b[0;37m%d", config.cpu);
         CDOWN(4);
         CUP(lines);
         if (idx > 0)
@@ -260,17 +520,18 @@ int CConfigInteractive()
             case 0:
                 CUP(2);
                 LOGCLEAR("Please enter the new value. => ");
-                int vali;
+                int vali = *(keys[idx].pointer_int);
 
                 char *p, s[64];
                 while (fgets(s, sizeof(s), stdin)) {
-                    vali = strtol(s, &p, 10);
+                    int parsed = strtol(s, &p, 10);
                     if ((p == s || *p != '\n')) {
                         CUP(1);
                         LOGCLEAR("Please enter the new value. => ");
                         continue;
                     }
 
+                    vali = parsed;
                     break;
                 }
                 CUP(1);
@@ -302,10 +563,37 @@ int CConfigInteractive()
             case 2:
                 *(keys[idx].pointer_int) = !*(keys[idx].pointer_int);
                 edit = 0;
+                break;
+            case 3:
+                CUP(2);
+                LOGCLEAR("Please enter the new value. => ");
+                /* The old value is kept unless a number is entered. */
+                double vald = *(keys[idx].pointer_double);
+
+                char *pd, sd[64];
+                while (fgets(sd, sizeof(sd), stdin)) {
+                    double parsed = strtod(sd, &pd);
+                    if ((pd == sd || *pd != '\n')) {
+                        CUP(1);
+                        LOGCLEAR("Please enter the new value. => ");
+                        continue;
+                    }
+
+                    vald = parsed;
+                    break;
+                }
+                CUP(1);
+                LCLEAR();
+                CDOWN(2);
+
+                *(keys[idx].pointer_double) = vald;
+                edit = 0;
+
                 break;
         }
     }
 
     CSetConfig(config);
+    CFreeConfig(&config);
     return EXIT_SUCCESS;
 }
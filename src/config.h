@@ -24,29 +24,82 @@
  * - 0 = int
  * - 1 = char *
  * - 2 = bool (int)
+ * - 3 = double
  */
 typedef struct {
     int *pointer_int;
     char **pointer_str;
+    double *pointer_double;
     int type;
 } EConfigKey;
 
+/*
+ * Size of the buffer of each string value, and the count of string values besides the profile.
+ */
+#define CONFIG_VALUE_SIZE 256
+#define CONFIG_STRING_COUNT 11
+
 /*
  * Basic struct that holds abstouch-nux configuration.
  */
 typedef struct {
+    char *profile;
+
+    char *devices;
+    int threads;
+
     int event;
     char *event_name;
 
     char *display;
     int screen;
 
+    char *output;
+    char *target;
+    char *contact;
+
     int use_defaults;
+    int grab;
 
     int x_min;
     int x_max;
     int y_min;
     int y_max;
+    double calibrate_low;
+    double calibrate_high;
+    char *homography;
+    int correction;
+    int correction_columns;
+    int correction_rows;
+
+    int orientation;
+    int mirror;
+
+    char *filter;
+    double filter_min_cutoff;
+    double filter_beta;
+    double filter_d_cutoff;
+    double filter_process_noise;
+    double filter_measurement_noise;
+    double filter_predict_ms;
+
+    int palm;
+    double palm_size;
+    double palm_pressure;
+    double palm_hysteresis;
+    int palm_settle_ms;
+
+    char *press;
+    char *press_code;
+    double press_pressure;
+    double press_hysteresis;
+    int press_tap_ms;
+    double press_tap_move;
+
+    int realtime;
+    char *realtime_policy;
+    int realtime_priority;
+    int cpu;
 
     int error;
 } EConfig;
@@ -67,7 +120,17 @@ int CConfigExists(char *config);
 EConfig CGetConfig(void);
 
 /*
- * Saves the configuration to the config file.
+ * Returns the configuration saved in the config file of `profile`.
+ */
+EConfig CGetProfile(char *profile);
+
+/*
+ * Frees the strings of the `config` returned by `CGetProfile`.
+ */
+void CFreeConfig(EConfig *config);
+
+/*
+ * Saves the configuration to the config file of its profile.
  */
 int CSetConfig(EConfig config);
 
@@ -82,9 +145,19 @@ int CSetEventInteractive(void);
 int CSetDisplayInteractive(void);
 
 /*
- * Calibrate the touchpad and set the configuration about limits.
+ * Calibrate the touchpad of `profile` and set the configuration about limits.
+ */
+int CCalibrate(char *profile, int visual);
+
+/*
+ * Calibrate the touchpad of `profile` with four touched corners and set the homography.
+ */
+int CCalibrateCorners(char *profile);
+
+/*
+ * Calibrate the touchpad of `profile` with a grid of touched points and write its correction table.
  */
-int CCalibrate(int visual);
+int CCalibrateGrid(char *profile);
 
 /*
  * Changes or shows the configuration interactively.
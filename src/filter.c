@@ -0,0 +1,146 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#include "filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Returns the filter type with the given `name` or -1 if unknown.
+ */
+int FGetFilterType(char *name)
+{
+    if (!strcmp(name, "none"))
+        return FILTER_NONE;
+    else if (!strcmp(name, "oneeuro"))
+        return FILTER_ONE_EURO;
+    else if (!strcmp(name, "predict"))
+        return FILTER_PREDICT;
+    return -1;
+}
+
+/*
+ * Initializes the `filter` with the filter parameters in `config`.
+ */
+int FInitFilter(EFilter *filter, EConfig *config)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->type = FGetFilterType(config->filter);
+    if (filter->type < 0)
+        return EXIT_FAILURE;
+
+    filter->min_cutoff = config->filter_min_cutoff;
+    filter->beta = config->filter_beta;
+    filter->d_cutoff = config->filter_d_cutoff;
+    filter->process_noise = config->filter_process_noise;
+    filter->measurement_noise = config->filter_measurement_noise;
+    filter->predict = config->filter_predict_ms / 1000.0;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns the smoothing factor of a low-pass filter with `cutoff` Hz over `dt` seconds.
+ */
+static double smoothing_factor(double cutoff, double dt)
+{
+    double r = 2 * M_PI * cutoff * dt;
+    return r / (r + 1);
+}
+
+/*
+ * Filters `value` on `axis` with the One Euro filter.
+ */
+static double one_euro(EFilter *filter, EFilterAxis *axis, double value, double dt)
+{
+    double a_d = smoothing_factor(filter->d_cutoff, dt);
+    axis->dx += a_d * ((value - axis->x) / dt - axis->dx);
+
+    double cutoff = filter->min_cutoff + filter->beta * fabs(axis->dx);
+    axis->x += smoothing_factor(cutoff, dt) * (value - axis->x);
+    return axis->x;
+}
+
+/*
+ * Filters `value` on `axis` with the constant velocity Kalman filter and extrapolates it ahead.
+ */
+static double predict(EFilter *filter, EFilterAxis *axis, double value, double dt)
+{
+    /* Predict with a constant velocity, the noise is of a white acceleration. */
+    double q = filter->process_noise;
+    double dt2 = dt * dt;
+    axis->x += axis->dx * dt;
+    double p00 = axis->p00 + dt * (2 * axis->p01 + dt * axis->p11) + q * dt2 * dt2 / 4;
+    double p01 = axis->p01 + dt * axis->p11 + q * dt2 * dt / 2;
+    double p11 = axis->p11 + q * dt2;
+
+    /* Correct with the measured position. */
+    double s = p00 + filter->measurement_noise;
+    double k0 = p00 / s, k1 = p01 / s;
+    double residual = value - axis->x;
+    axis->x += k0 * residual;
+    axis->dx += k1 * residual;
+    axis->p00 = (1 - k0) * p00;
+    axis->p01 = (1 - k0) * p01;
+    axis->p11 = p11 - k1 * p01;
+
+    return axis->x + axis->dx * filter->predict;
+}
+
+/*
+ * Filters the position at `x`, `y` sampled at `time` seconds in place.
+ */
+void FApplyFilter(EFilter *filter, double time, int *x, int *y)
+{
+    if (filter->type == FILTER_NONE)
+        return;
+
+    double dt = time - filter->time;
+    if (!filter->initialized || dt < 0 || dt > FILTER_RESET_GAP) {
+        /* Starts over from the measured position on the first sample and after gaps. */
+        double values[2] = {*x, *y};
+        for (int i = 0; i < 2; i++) {
+            EFilterAxis *axis = &filter->axes[i];
+            memset(axis, 0, sizeof(*axis));
+            axis->x = values[i];
+            axis->p00 = filter->measurement_noise;
+            axis->p11 = filter->process_noise;
+        }
+        filter->initialized = 1;
+        filter->time = time;
+        return;
+    }
+
+    /* Frames with the same timestamp would divide by zero. */
+    if (dt < FILTER_MIN_DT)
+        dt = FILTER_MIN_DT;
+    filter->time = time;
+
+    double fx, fy;
+    if (filter->type == FILTER_ONE_EURO) {
+        fx = one_euro(filter, &filter->axes[0], *x, dt);
+        fy = one_euro(filter, &filter->axes[1], *y, dt);
+    } else {
+        fx = predict(filter, &filter->axes[0], *x, dt);
+        fy = predict(filter, &filter->axes[1], *y, dt);
+    }
+
+    *x = (int) lround(fx);
+    *y = (int) lround(fy);
+}
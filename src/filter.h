@@ -0,0 +1,89 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _FILTER_H
+#define _FILTER_H
+
+#include "config.h"
+
+/*
+ * Filter types.
+ * - FILTER_NONE = Passes the positions through.
+ * - FILTER_ONE_EURO = One Euro filter, smooths more the slower the finger moves.
+ * - FILTER_PREDICT = Constant velocity Kalman filter that extrapolates ahead to hide latency.
+ */
+#define FILTER_NONE 0
+#define FILTER_ONE_EURO 1
+#define FILTER_PREDICT 2
+
+/*
+ * Gap in seconds after which the filter starts over instead of smoothing across strokes.
+ */
+#define FILTER_RESET_GAP 0.1
+
+/*
+ * Smallest time step in seconds between two filtered samples.
+ */
+#define FILTER_MIN_DT 0.0001
+
+/*
+ * Struct that holds the filter state of one axis.
+ */
+typedef struct {
+    /* Filtered position and velocity. */
+    double x;
+    double dx;
+
+    /* Covariance of the Kalman filter. */
+    double p00, p01, p11;
+} EFilterAxis;
+
+/*
+ * Struct that holds a filter stage with its parameters and state.
+ */
+typedef struct {
+    int type;
+
+    double min_cutoff;
+    double beta;
+    double d_cutoff;
+
+    double process_noise;
+    double measurement_noise;
+    double predict;
+
+    int initialized;
+    double time;
+    EFilterAxis axes[2];
+} EFilter;
+
+/*
+ * Returns the filter type with the given `name` or -1 if unknown.
+ */
+int FGetFilterType(char *name);
+
+/*
+ * Initializes the `filter` with the filter parameters in `config`.
+ */
+int FInitFilter(EFilter *filter, EConfig *config);
+
+/*
+ * Filters the position at `x`, `y` sampled at `time` seconds in place.
+ */
+void FApplyFilter(EFilter *filter, double time, int *x, int *y);
+
+#endif /* _FILTER_H */
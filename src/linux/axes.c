@@ -0,0 +1,42 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "axes.h"
+#include "probe.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+/*
+ * Reads the absolute axes of the event `fd` into `axes`.
+ * `axes` is left without any axis if `fd` is negative or can't be read.
+ */
+int LReadAxes(int fd, EAxes *axes)
+{
+    memset(axes, 0, sizeof(*axes));
+
+    unsigned long abs_bits[PROBE_LONGS(ABS_CNT)] = {0};
+    if (fd < 0 || ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits) < 0)
+        return EXIT_FAILURE;
+
+    for (int code = 0; code < ABS_CNT; code++) {
+        if (PROBE_TEST_BIT(code, abs_bits) && !ioctl(fd, EVIOCGABS(code), &axes->absinfo[code]))
+            axes->abs_bits |= 1ULL << code;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,47 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_AXES_H
+#define _LINUX_AXES_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/*
+ * Struct that holds the absolute axes of a device, read from it or from a recording.
+ * `abs_bits` has a bit set for every axis in `absinfo` that the device has.
+ */
+typedef struct {
+    uint64_t abs_bits;
+    struct input_absinfo absinfo[ABS_CNT];
+} EAxes;
+
+/*
+ * Reads the absolute axes of the event `fd` into `axes`.
+ * `axes` is left without any axis if `fd` is negative or can't be read.
+ */
+int LReadAxes(int fd, EAxes *axes);
+
+/*
+ * Returns true if the device of `axes` has the axis `code`.
+ */
+static inline int LHasAxis(const EAxes *axes, int code)
+{
+    return (axes->abs_bits >> code) & 1;
+}
+
+#endif /* _LINUX_AXES_H */
@@ -0,0 +1,176 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "calibration.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/ioctl.h>
+
+#include <linux/input.h>
+
+/*
+ * Sets the range of the `axis` from the multitouch `mt_code` or the single touch `code` axis of `fd`.
+ * Without either the range follows the samples, without trimming them.
+ */
+static void probe_axis(ECalibrationAxis *axis, int fd, int mt_code, int code)
+{
+    struct input_absinfo absinfo;
+    if ((!ioctl(fd, EVIOCGABS(mt_code), &absinfo) && absinfo.maximum > absinfo.minimum)
+        || (!ioctl(fd, EVIOCGABS(code), &absinfo) && absinfo.maximum > absinfo.minimum)) {
+        axis->min = absinfo.minimum;
+        axis->max = absinfo.maximum;
+        axis->known = 1;
+    } else {
+        axis->min = 0;
+        axis->max = 65535;
+    }
+    axis->low = axis->max;
+    axis->high = axis->min;
+}
+
+/*
+ * Returns the bin of `value` in `min` - `max` split into `count` bins.
+ */
+static int bin(int value, int min, int max, int count)
+{
+    if (value <= min)
+        return 0;
+    if (value >= max)
+        return count - 1;
+    return (int) ((int64_t) (value - min) * count / ((int64_t) max - min + 1));
+}
+
+/*
+ * Returns the value of the `axis` at the `quantile` of the `count` samples,
+ * interpolated inside its bin and kept between the extremes.
+ */
+static int quantile(ECalibrationAxis *axis, uint64_t count, double quantile)
+{
+    double rank = quantile * count;
+    double width = ((double) axis->max - axis->min + 1) / CALIBRATION_BINS;
+    uint64_t seen = 0;
+    int value = axis->high;
+    for (int i = 0; i < CALIBRATION_BINS; i++) {
+        if (!axis->bins[i])
+            continue;
+        if (seen + axis->bins[i] >= rank) {
+            value = axis->min + (int) round((i + (rank - seen) / axis->bins[i]) * width);
+            break;
+        }
+        seen += axis->bins[i];
+    }
+
+    if (value < axis->low)
+        return axis->low;
+    if (value > axis->high)
+        return axis->high;
+    return value;
+}
+
+/*
+ * Initializes the `calibration` for the range of the event `fd` with the percentiles in `config`.
+ */
+int LCalibrationInit(ECalibration *calibration, int fd, EConfig *config)
+{
+    memset(calibration, 0, sizeof(*calibration));
+    if (config->calibrate_low < 0 || config->calibrate_high > 100 || config->calibrate_low >= config->calibrate_high) {
+        ERRLN("The calibration percentiles must be between 0 and 100, the low one below the high one.");
+        return EXIT_FAILURE;
+    }
+
+    calibration->low = config->calibrate_low / 100;
+    calibration->high = config->calibrate_high / 100;
+    probe_axis(&calibration->x, fd, ABS_MT_POSITION_X, ABS_X);
+    probe_axis(&calibration->y, fd, ABS_MT_POSITION_Y, ABS_Y);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Counts the position of `frame` if it is touching with a contact that isn't rejected,
+ * and is inside the range of the device.
+ * Returns true if the sample was taken.
+ */
+int LCalibrationSample(ECalibration *calibration, const EFrame *frame)
+{
+    ECalibrationAxis *x = &calibration->x, *y = &calibration->y;
+    if (frame->contacts <= 0 || frame->rejected
+        || (x->known && (frame->x < x->min || frame->x > x->max))
+        || (y->known && (frame->y < y->min || frame->y > y->max))) {
+        calibration->rejected++;
+        return 0;
+    }
+
+    x->bins[bin(frame->x, x->min, x->max, CALIBRATION_BINS)]++;
+    y->bins[bin(frame->y, y->min, y->max, CALIBRATION_BINS)]++;
+    calibration->grid[bin(frame->y, y->min, y->max, CALIBRATION_GRID)][bin(frame->x, x->min, x->max, CALIBRATION_GRID)]++;
+
+    if (frame->x < x->low) x->low = frame->x;
+    if (frame->x > x->high) x->high = frame->x;
+    if (frame->y < y->low) y->low = frame->y;
+    if (frame->y > y->high) y->high = frame->y;
+
+    calibration->samples++;
+    return 1;
+}
+
+/*
+ * Works out the limits at the percentiles of the `calibration`.
+ * Returns EXIT_FAILURE if there aren't enough samples yet.
+ */
+int LCalibrationLimits(ECalibration *calibration, int *x_min, int *y_min, int *x_max, int *y_max)
+{
+    if (calibration->samples < CALIBRATION_MIN_SAMPLES)
+        return EXIT_FAILURE;
+
+    *x_min = quantile(&calibration->x, calibration->samples, calibration->low);
+    *x_max = quantile(&calibration->x, calibration->samples, calibration->high);
+    *y_min = quantile(&calibration->y, calibration->samples, calibration->low);
+    *y_max = quantile(&calibration->y, calibration->samples, calibration->high);
+    return *x_max > *x_min && *y_max > *y_min ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Returns the fraction of the occupancy grid inside the limits that has samples.
+ */
+double LCalibrationCoverage(ECalibration *calibration, int x_min, int y_min, int x_max, int y_max)
+{
+    ECalibrationAxis *x = &calibration->x, *y = &calibration->y;
+    int column_min = bin(x_min, x->min, x->max, CALIBRATION_GRID), column_max = bin(x_max, x->min, x->max, CALIBRATION_GRID);
+    int row_min = bin(y_min, y->min, y->max, CALIBRATION_GRID), row_max = bin(y_max, y->min, y->max, CALIBRATION_GRID);
+
+    int covered = 0, total = 0;
+    for (int i = row_min; i <= row_max; i++) {
+        for (int j = column_min; j <= column_max; j++) {
+            covered += calibration->grid[i][j] > 0;
+            total++;
+        }
+    }
+    return total ? (double) covered / total : 0;
+}
+
+/*
+ * Returns the confidence in the limits from the `coverage` and the count of samples, from 0 to 1.
+ */
+double LCalibrationConfidence(ECalibration *calibration, double coverage)
+{
+    double samples = (double) calibration->samples / CALIBRATION_FULL_SAMPLES;
+    return coverage * (samples < 1 ? samples : 1);
+}
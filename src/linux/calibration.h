@@ -0,0 +1,96 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_CALIBRATION_H
+#define _LINUX_CALIBRATION_H
+
+#include "frame.h"
+#include "../config.h"
+
+#include <stdint.h>
+
+/*
+ * Bins of the histogram each axis is sketched in.
+ */
+#define CALIBRATION_BINS 1024
+
+/*
+ * Cells per side of the occupancy grid the coverage is measured in.
+ */
+#define CALIBRATION_GRID 32
+
+/*
+ * Samples needed before the limits are taken, and for full confidence.
+ */
+#define CALIBRATION_MIN_SAMPLES 100
+#define CALIBRATION_FULL_SAMPLES 2000
+
+/*
+ * Struct that holds the histogram of the samples on one axis over the range of the device.
+ */
+typedef struct {
+    int min, max;
+    int known;
+
+    /* Extremes of the accepted samples. */
+    int low, high;
+    uint32_t bins[CALIBRATION_BINS];
+} ECalibrationAxis;
+
+/*
+ * Struct that holds the state of a calibration in constant memory, whatever the count of samples.
+ * `low` and `high` are the percentiles the limits are taken at, as fractions.
+ */
+typedef struct {
+    ECalibrationAxis x, y;
+    uint32_t grid[CALIBRATION_GRID][CALIBRATION_GRID];
+
+    uint64_t samples;
+    uint64_t rejected;
+
+    double low, high;
+} ECalibration;
+
+/*
+ * Initializes the `calibration` for the range of the event `fd` with the percentiles in `config`.
+ */
+int LCalibrationInit(ECalibration *calibration, int fd, EConfig *config);
+
+/*
+ * Counts the position of `frame` if it is touching with a contact that isn't rejected,
+ * and is inside the range of the device.
+ * Returns true if the sample was taken.
+ */
+int LCalibrationSample(ECalibration *calibration, const EFrame *frame);
+
+/*
+ * Works out the limits at the percentiles of the `calibration`.
+ * Returns EXIT_FAILURE if there aren't enough samples yet.
+ */
+int LCalibrationLimits(ECalibration *calibration, int *x_min, int *y_min, int *x_max, int *y_max);
+
+/*
+ * Returns the fraction of the occupancy grid inside the limits that has samples.
+ */
+double LCalibrationCoverage(ECalibration *calibration, int x_min, int y_min, int x_max, int y_max);
+
+/*
+ * Returns the confidence in the limits from the `coverage` and the count of samples, from 0 to 1.
+ */
+double LCalibrationConfidence(ECalibration *calibration, double coverage);
+
+#endif /* _LINUX_CALIBRATION_H */
@@ -19,6 +19,16 @@
 #include "client.h"
 #include "event.h"
 #include "display.h"
+#include "frame.h"
+#include "output.h"
+#include "loop.h"
+#include "pipeline.h"
+#include "realtime.h"
+#include "hotplug.h"
+#include "control.h"
+#include "log.h"
+#include "visual.h"
+#include "calibration.h"
 #include "../print.h"
 
 #include <stdio.h>
@@ -26,8 +36,17 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <math.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
 
 #include <linux/input.h>
 #include <X11/extensions/XInput.h>
@@ -40,142 +59,947 @@ static int gverbose = 0;
 #define VERBOSE(fmt, args...) if (!gdaemon && gverbose) printf(fmt, ##args);
 
 /*
- * Interrupt signal handler that while loops depend on.
+ * Maximum count of devices a single input client serves.
  */
-static volatile sig_atomic_t stop = 0;
+#define CLIENT_MAX_DEVICES 8
 
 /*
- * Sets `stop` to true to stop loop on interrupt or termination.
+ * Struct that holds a control request for a device, handed to the input thread that runs the device.
+ * A reload comes with the `config` and `correction` read beforehand, and goes back with the ones they replaced.
  */
-static void signal_handler(int _sig)
+typedef struct {
+    int command;
+    char *argument;
+    EControlResponse *response;
+    EConfig config;
+    ECorrection correction;
+} EClientRequest;
+
+/*
+ * Struct that holds the state of a device served by the running input client.
+ */
+typedef struct {
+    int fd;
+    int status;
+
+    EConfig config;
+    char profile[256];
+    EPipeline pipeline;
+    EOutput output;
+    XDevice *device;
+    int grabbed;
+    int paused;
+
+    /* Watch for the device to come back and the time it was lost. */
+    EHotplug hotplug;
+    uint64_t lost_ns;
+
+    /* Ring the verbose output goes through, NULL if there is none. */
+    ELog *log;
+
+    /* The input thread runs the device, woken up through `wake_fd` for the `request` and posting `done` after it. */
+    _Atomic int running;
+    int wake_fd;
+    sem_t done;
+    EClientRequest *request;
+} EClient;
+
+/*
+ * Struct that holds an input thread and the devices its loop serves,
+ * with the realtime guarantees of `config`.
+ */
+typedef struct {
+    EClient *clients;
+    int count;
+    EConfig *config;
+
+    pthread_t thread;
+    int joinable;
+    int exit_fd;
+} EInput;
+
+/*
+ * Struct that holds the state of the running input client and its devices.
+ */
+typedef struct {
+    EClient clients[CLIENT_MAX_DEVICES];
+    int count;
+    int threads;
+    int status;
+
+    /* One input thread serves every device, or every device has one of its own. */
+    EInput inputs[CLIENT_MAX_DEVICES];
+    int input_count;
+
+    /* Thread that prints the verbose output of every device. */
+    ELogPrinter printer;
+
+    /* The control socket, the watch for changes of the configuration files,
+       and the eventfd the input threads post to when they end. */
+    int control_fd;
+    int config_fd;
+    int exit_fd;
+} EDaemon;
+
+/*
+ * Reads the configuration of `profile` and its correction table into the `request`.
+ * Runs on the thread of the control socket, so the input thread only has to swap them in.
+ */
+static int prepare_reload(EClientRequest *request, char *profile)
 {
-    stop = 1;
+    request->config = CGetProfile(profile);
+    if (request->config.error || LPipelineOpenCorrection(&request->config, &request->correction)) {
+        CFreeConfig(&request->config);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
 }
 
 /*
- * Input client for GNU/Linux.
+ * Frees the configuration and the correction table the `request` carries,
+ * the ones a reload replaced or the ones that were never swapped in.
  */
-int LInputClient(int verbose)
+static void finish_reload(EClientRequest *request)
 {
-    gverbose = verbose;
+    CFreeConfig(&request->config);
+    LCloseCorrection(&request->correction);
+}
 
-    EConfig config = CGetConfig();
-    if (config.error) {
-        if (!CConfigExists("abstouch-nux")) {
-            ERRLN("abstouch-nux has not been set up.");
-            LOGLN("See: \x1b[;mabstouch setup");
-        } else
-            ERRLN("Couldn't get the abstouch-nux configuration.");
+/*
+ * Swaps the configuration prepared in the `request` into the running `client`.
+ * The device, the display and the grab are kept as they are.
+ */
+static int reload(EClient *client, EClientRequest *request)
+{
+    if (LPipelineConfigure(&client->pipeline, &request->config, &request->correction))
         return EXIT_FAILURE;
+
+    /* The old configuration goes back with the request, so it is freed off the input thread too. */
+    EConfig config = client->config;
+    client->config = request->config;
+    request->config = config;
+    LLogPush(client->log, &(ELogRecord) {.type = LOG_RELOADED});
+    return EXIT_SUCCESS;
+}
+
+static int daemon_request(EDaemon *daemon, int command, char *argument, int device, EControlResponse *response);
+
+/*
+ * Stops the `loop` on interrupt or termination.
+ * Reloads the configuration of the devices of the input client in `data` on hangup.
+ */
+static void signal_callback(ELoop *loop, int sig, void *data)
+{
+    if (sig == SIGINT || sig == SIGTERM)
+        LLoopStop(loop);
+    else if (sig == SIGHUP && data != NULL) {
+        EControlResponse response;
+        daemon_request(data, CONTROL_RELOAD, NULL, CONTROL_ALL_DEVICES, &response);
     }
+}
 
-    int fd = LOpenEvent(config.event);
+/*
+ * Returns a new non-blocking inotify fd that watches for the configuration file to be written.
+ * The directory is watched, so editors that replace the file are noticed as well.
+ */
+static int watch_config(void)
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
     if (fd < 0)
-        return EXIT_FAILURE;
+        return -1;
 
-    if (!LIsAbsoluteEvent(config.event)) {
-        int newevent = LGetEventByName(config.event_name);
-        if (newevent < 0 || !LIsAbsoluteEvent(newevent)) {
-            ERRLN("Event has no absolute input.");
-            return EXIT_FAILURE;
-        }
+    char *dir = CGetConfigDir();
+    int wd = inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    free(dir);
+    if (wd < 0) {
+        close(fd);
+        return -1;
+    }
 
-        config.event = newevent;
-        CSetConfig(config);
-        fd = LOpenEvent(newevent);
-        if (fd < 0)
-            return EXIT_FAILURE;
+    return fd;
+}
+
+/*
+ * Reloads the configuration of the devices of the input client in `data` whose files were written.
+ */
+static void config_callback(ELoop *loop, int fd, void *data)
+{
+    EDaemon *daemon = data;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed[CLIENT_MAX_DEVICES] = {0};
+    ssize_t len;
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *) p)->len) {
+            struct inotify_event *event = (struct inotify_event *) p;
+            for (int i = 0; event->len && i < daemon->count; i++) {
+                size_t len = strlen(daemon->clients[i].profile);
+                if (!strncmp(event->name, daemon->clients[i].profile, len) && !strcmp(event->name + len, ".conf"))
+                    changed[i] = 1;
+            }
+        }
     }
-    LOGLNIF(!gdaemon && gverbose, "Found absolute input on event \x1b[0;37m%d\x1b[1;37m.", config.event);
 
-    Display *display = XOpenDisplay(config.display);
-    Window root_window = XRootWindow(display, config.screen);
-    XWindowAttributes window_attributes;
-    XGetWindowAttributes(display, root_window, &window_attributes);
-    XSelectInput(display, root_window, KeyReleaseMask);
-    SUCCESSLNIF(!gdaemon && gverbose, "Successfully bound to display \x1b[0;37m%s\x1b[1;36m.\x1b[0;37m%d\x1b[1;37m.", config.display, config.screen);
+    for (int i = 0; i < daemon->count; i++) {
+        EControlResponse response;
+        if (changed[i])
+            daemon_request(daemon, CONTROL_RELOAD, NULL, i, &response);
+    }
+}
 
-    WARNLNIF(LIsXWayland(display), "Running on XWayland. All features might not be available.");
-    if (LIsXWayland(display)) {
-        ERRLN("XWayland is currently not supported for input.");
-        return EXIT_FAILURE;
+/*
+ * Drains the X event queue so the connection never backs up,
+ * and rebuilds the mapping of the client in `data` when the layout changes.
+ */
+static void display_callback(ELoop *loop, int fd, void *data)
+{
+    EClient *client = data;
+    Display *display = client->output.display;
+    XEvent event;
+    int changed = 0;
+    while (XPending(display)) {
+        XNextEvent(display, &event);
+        changed |= LTargetHandleEvent(&client->pipeline.target, &event);
     }
 
+    if (changed)
+        LPipelineRetarget(&client->pipeline, &client->config);
+}
+
+/*
+ * Reads every queued event from the evdev `fd` into the pipeline of the `client`.
+ * Returns the count of completed frames or -1 if the device is gone.
+ */
+static int read_frames(EClient *client, int fd)
+{
     struct input_event ev[64];
-    int rd;
-    fd_set rdfs;
-    FD_ZERO(&rdfs);
-    FD_SET(fd, &rdfs);
-
-    int abs_x[6] = {0}, abs_y[6] = {0}, abs_pressure[6] = {0};
-    ioctl(fd, EVIOCGABS(ABS_X), abs_x);
-    ioctl(fd, EVIOCGABS(ABS_Y), abs_y);
-    ioctl(fd, EVIOCGABS(ABS_PRESSURE), abs_pressure);
-    int x_min = config.x_min, x_max = config.x_max;
-    int y_min = config.y_min, y_max = config.y_max;
-    int pressure_min = abs_pressure[1], pressure_max = abs_pressure[2];
-    int x, y, pressure;
-
-    XDevice *device = LOpenXDevice(display, config.event_name);
-    if (!config.use_defaults)
+    int frames = 0;
+    for (;;) {
+        int rd = read(fd, ev, sizeof(ev));
+        if (rd < 0 && errno == EAGAIN)
+            return frames;
+        if (rd < (int) sizeof(struct input_event))
+            return -1;
+
+        /* While paused the frames are only assembled, nothing is pressed. */
+        int count = rd / sizeof(struct input_event);
+        if (client->paused)
+            frames += LFrameFeed(&client->pipeline.assembler, ev, count);
+        else
+            frames += LPipelineFeed(&client->pipeline, ev, count);
+    }
+}
+
+/*
+ * Stops the default behavior of the touchpad, preferring an exclusive grab of `fd`
+ * and falling back to disabling its XInput device on `display`.
+ * Sets `grabbed` and returns the disabled XInput device, or NULL if there is nothing to re-enable.
+ */
+static XDevice *disable_defaults(EConfig *config, int fd, Display *display, int *grabbed)
+{
+    *grabbed = config->grab && !LGrabEvent(fd, 1);
+    if (*grabbed)
+        return NULL;
+    if (display == NULL)
+        return NULL;
+
+    XDevice *device = LOpenXDevice(display, config->event_name);
+    if (device != NULL)
         LSetXDeviceEnabled(display, device, 0);
+    return device;
+}
+
+static void input_callback(ELoop *loop, int fd, void *data);
+
+/*
+ * Attaches the event `fd` of the device that came back to the `client`.
+ */
+static void reattach(ELoop *loop, EClient *client, int fd)
+{
+    int clock_id = CLOCK_MONOTONIC;
+    client->pipeline.clock = ioctl(fd, EVIOCSCLOCKID, &clock_id) ? CLOCK_REALTIME : CLOCK_MONOTONIC;
+    if (!client->config.use_defaults && !client->paused)
+        client->device = disable_defaults(&client->config, fd, client->output.display, &client->grabbed);
+
+    /* The device might have come back with other slots and ranges. */
+    LFrameInit(&client->pipeline.assembler, fd);
+    LFrameConfigure(&client->pipeline.assembler, &client->config);
+    if (LLoopAdd(loop, fd, input_callback, client) < 0) {
+        close(fd);
+        client->status = EXIT_FAILURE;
+        LLoopStop(loop);
+        return;
+    }
+
+    client->fd = fd;
+    LStatsReattach(client->pipeline.stats, LStatsNow(CLOCK_MONOTONIC) - client->lost_ns);
+    LLogPush(client->log, &(ELogRecord) {.type = LOG_BACK});
+}
+
+/*
+ * Detaches the lost device from the `client` and waits for it to come back.
+ */
+static void detach(ELoop *loop, EClient *client)
+{
+    LPipelineRelease(&client->pipeline);
+    LLoopRemove(loop, client->fd);
+    close(client->fd);
+    client->fd = -1;
+    client->grabbed = 0;
+    client->lost_ns = LStatsNow(CLOCK_MONOTONIC);
+
+    /* X removes its device along with the event, so it is only freed locally. */
+    if (client->device != NULL) {
+        XFree(client->device);
+        client->device = NULL;
+    }
+
+    if (client->hotplug.fd < 0) {
+        client->status = EXIT_FAILURE;
+        LLoopStop(loop);
+        return;
+    }
+
+    LLogPush(client->log, &(ELogRecord) {.type = LOG_LOST});
+    int fd = LHotplugScan(&client->hotplug);
+    if (fd >= 0)
+        reattach(loop, client, fd);
+}
+
+/*
+ * Maps the latest complete frame to the output whenever the device is readable.
+ */
+static void input_callback(ELoop *loop, int fd, void *data)
+{
+    EClient *client = data;
+
+    /* Only the position of the latest complete frame is mapped, partial frames wait for the next read. */
+    int frames = read_frames(client, fd);
+    if (frames < 0) {
+        detach(loop, client);
+        return;
+    }
+    if (!frames || client->paused)
+        return;
+
+    LPipelineOutput(&client->pipeline);
+
+    /* The terminal is written by the printer thread of the log, never from here. */
+    if (client->log != NULL) {
+        EFrame *frame = &client->pipeline.assembler.frame;
+        ELogRecord record = {
+            .time_ns = (uint64_t) frame->time.tv_sec * 1000000000ULL + frame->time.tv_usec * 1000ULL,
+            .type = LOG_INPUT,
+            .x = frame->x, .y = frame->y, .pressure = frame->pressure,
+            .cx = client->pipeline.cx, .cy = client->pipeline.cy
+        };
+        LLogPush(client->log, &record);
+    }
+}
 
-    stop = 0;
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    LOGLNIF(!gdaemon && gverbose, "Waiting for input...\n");
-    while (!stop) {
-        select(fd + 1, &rdfs, NULL, NULL, NULL);
-        if (stop)
+/*
+ * Reattaches the lost device as soon as it appears again.
+ */
+static void hotplug_callback(ELoop *loop, int fd, void *data)
+{
+    EClient *client = data;
+    int event = LHotplugRead(&client->hotplug, client->fd < 0);
+    if (event >= 0)
+        reattach(loop, client, event);
+}
+
+/*
+ * Pauses the mapping of the `client` and gives the touchpad its default behavior back,
+ * or takes it again and resumes the mapping.
+ */
+static void set_paused(EClient *client, int paused)
+{
+    if (client->paused == paused)
+        return;
+
+    client->paused = paused;
+    if (paused)
+        LPipelineRelease(&client->pipeline);
+    if (client->fd < 0 || client->config.use_defaults)
+        return;
+
+    if (!paused) {
+        client->device = disable_defaults(&client->config, client->fd, client->output.display, &client->grabbed);
+        return;
+    }
+
+    if (client->grabbed)
+        LGrabEvent(client->fd, 0);
+    client->grabbed = 0;
+    if (client->device != NULL) {
+        LSetXDeviceEnabled(client->output.display, client->device, 1);
+        XCloseDevice(client->output.display, client->device);
+        client->device = NULL;
+    }
+}
+
+/*
+ * Runs the control `request` on the `client` and fills in its response.
+ * Must be called from the input thread that runs the client.
+ */
+static void client_request(EClient *client, EClientRequest *request)
+{
+    EControlResponse *response = request->response;
+    switch (request->command) {
+        case CONTROL_RELOAD:
+        case CONTROL_PROFILE:
+            response->status = reload(client, request);
             break;
-        rd = read(fd, ev, sizeof(ev));
+        case CONTROL_STATUS:
+        case CONTROL_STATS:
+            break;
+        case CONTROL_PAUSE:
+            set_paused(client, 1);
+            break;
+        case CONTROL_RESUME:
+            set_paused(client, 0);
+            break;
+        default:
+            response->status = EXIT_FAILURE;
+            break;
+    }
 
-        if (rd < (int) sizeof(struct input_event))
+    response->event = client->config.event;
+    response->paused = client->paused;
+    response->attached = client->fd >= 0;
+}
+
+/*
+ * Runs the request posted to the input thread of the client in `data`, or stops its `loop`.
+ */
+static void wake_callback(ELoop *loop, int fd, void *data)
+{
+    EClient *client = data;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+        return;
+
+    if (client->request->command == CONTROL_STOP)
+        LLoopStop(loop);
+    else
+        client_request(client, client->request);
+    sem_post(&client->done);
+}
+
+/*
+ * Waits for the input thread of the `client` to run the posted request.
+ * Returns EXIT_FAILURE if the thread ended before it did.
+ */
+static int wait_request(EClient *client)
+{
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        if (!sem_timedwait(&client->done, &deadline))
+            return EXIT_SUCCESS;
+        if (errno != EINTR && errno != ETIMEDOUT)
             return EXIT_FAILURE;
 
-        for (int i = 0; i < rd / sizeof(struct input_event); i++) {
-            unsigned int type, code;
-            type = ev[i].type;
-            code = ev[i].code;
+        /* The thread might have run it right before it ended. */
+        if (!client->running)
+            return sem_trywait(&client->done) ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+}
 
-            if (type != EV_ABS)
-                continue;
+/*
+ * Runs the control `command` with `argument` on the device at index `device`, or on every device,
+ * of the `daemon`. The response is the one of the first device the command ran on.
+ */
+static int daemon_request(EDaemon *daemon, int command, char *argument, int device, EControlResponse *response)
+{
+    if (device >= daemon->count || device < CONTROL_ALL_DEVICES)
+        return EXIT_FAILURE;
 
-            if (code == ABS_X) {
-                x = ev[i].value;
-                continue;
-            }
+    int status = EXIT_SUCCESS;
+    EControlResponse *first = response;
+    for (int i = 0; i < daemon->count; i++) {
+        EClient *client = &daemon->clients[i];
+        if ((device != CONTROL_ALL_DEVICES && i != device) || !client->running)
+            continue;
 
-            if (code == ABS_Y) {
-                y = ev[i].value;
-                continue;
-            }
+        EControlResponse other;
+        memset(&other, 0, sizeof(other));
+        EClientRequest request = {.command = command, .argument = argument, .response = first != NULL ? first : &other};
+        first = NULL;
+
+        /* The file is parsed and the table mapped here, the input thread never waits for the disk. */
+        int reloading = command == CONTROL_RELOAD || command == CONTROL_PROFILE;
+        char *profile = command == CONTROL_PROFILE ? argument : client->profile;
+        if (reloading && prepare_reload(&request, profile)) {
+            request.response->status = EXIT_FAILURE;
+            status = EXIT_FAILURE;
+            continue;
+        }
 
-            if (code == ABS_PRESSURE) {
-                pressure = ev[i].value;
-                continue;
-            }
+        /* The input thread owns the state of its device, so the request waits for it to run there. */
+        uint64_t one = 1;
+        client->request = &request;
+        if (write(client->wake_fd, &one, sizeof(one)) != sizeof(one) || wait_request(client))
+            request.response->status = EXIT_FAILURE;
+        client->request = NULL;
+        if (reloading) {
+            if (command == CONTROL_PROFILE && !request.response->status)
+                snprintf(client->profile, sizeof(client->profile), "%s", profile);
+            finish_reload(&request);
         }
 
-        if (!gdaemon && gverbose) {
-            CUP(2);
-            LCLEAR();
-            SUCCESSLN("Got input at \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d \x1b[1;37mwith \x1b[0;37m%d \x1b[1;37mpressure.\n", x, y, pressure);
-        }
+        snprintf(request.response->profile, sizeof(request.response->profile), "%s", client->profile);
+        status |= request.response->status;
+    }
+
+    response->status = status;
+    return status;
+}
+
+/*
+ * Answers the control request to the input client in `data` waiting on the connection `fd`.
+ */
+static void request_callback(ELoop *loop, int fd, void *data)
+{
+    EDaemon *daemon = data;
+    EControlRequest request;
+    ssize_t len = recv(fd, &request, sizeof(request), MSG_DONTWAIT);
+    if (len < 0 && errno == EAGAIN)
+        return;
+
+    EControlResponse response;
+    memset(&response, 0, sizeof(response));
+    response.magic = CONTROL_MAGIC;
+    if (len != sizeof(request) || request.magic != CONTROL_MAGIC || request.version != CONTROL_VERSION) {
+        LLoopRemove(loop, fd);
+        close(fd);
+        return;
+    }
+
+    /* A profile is switched for a single device, the first one unless one is given. */
+    request.argument[sizeof(request.argument) - 1] = '\0';
+    if (request.command == CONTROL_PROFILE && request.device == CONTROL_ALL_DEVICES)
+        request.device = 0;
+
+    if (request.command == CONTROL_STOP)
+        LLoopStop(loop);
+    else if (daemon_request(daemon, request.command, request.argument, request.device, &response))
+        response.status = EXIT_FAILURE;
+    response.pid = getpid();
+    response.devices = daemon->count;
+
+    /* The statistics are copied straight from the shared memory the client writes anyway. */
+    EStats *stats = NULL;
+    if (request.device >= 0 && request.device < daemon->count)
+        stats = daemon->clients[request.device].pipeline.stats;
+    else if (request.device == CONTROL_ALL_DEVICES)
+        stats = daemon->clients[0].pipeline.stats;
+    struct iovec iov[2] = {{.iov_base = &response, .iov_len = sizeof(response)}};
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 1};
+    if (request.command == CONTROL_STATS && stats != NULL) {
+        response.has_stats = 1;
+        iov[1].iov_base = stats;
+        iov[1].iov_len = sizeof(EStats);
+        msg.msg_iovlen = 2;
+    }
+    sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+    /* A stopping client keeps the connection open until it exits, which tells the sender it is gone. */
+    LLoopRemove(loop, fd);
+    if (request.command != CONTROL_STOP)
+        close(fd);
+}
+
+/*
+ * Accepts the connections waiting on the control socket `fd`.
+ */
+static void control_callback(ELoop *loop, int fd, void *data)
+{
+    int conn;
+    while ((conn = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        if (LLoopAdd(loop, conn, request_callback, data) < 0)
+            close(conn);
+    }
+}
+
+/*
+ * Stops the `loop` of the input client in `data` once all its input threads have ended.
+ */
+static void exit_callback(ELoop *loop, int fd, void *data)
+{
+    EDaemon *daemon = data;
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) != sizeof(count))
+        return;
+
+    for (int i = 0; i < daemon->count; i++) {
+        if (daemon->clients[i].running)
+            return;
+    }
+    LLoopStop(loop);
+}
+
+/*
+ * Opens the device configured in `profile` for the `client`, with its output, mapping and statistics,
+ * and stops its default behavior.
+ */
+static int open_client(EClient *client, char *profile)
+{
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+    client->status = EXIT_SUCCESS;
+    client->hotplug.fd = -1;
+    client->wake_fd = -1;
+    snprintf(client->profile, sizeof(client->profile), "%s", profile);
+
+    client->config = CGetProfile(client->profile);
+    if (client->config.error) {
+        ERRLN("Couldn't get the configuration \x1b[;m%s", client->profile);
+        return EXIT_FAILURE;
+    }
+
+    EConfig *config = &client->config;
+    int fd = LOpenConfiguredEvent(config);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    LOGLNIF(!gdaemon && gverbose, "Found absolute input on event \x1b[0;37m%d\x1b[1;37m for \x1b[0;37m%s\x1b[1;37m.", config->event, client->profile);
+
+    if (LOpenConfiguredOutput(&client->output, config, !gdaemon && gverbose)) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (LPipelineInit(&client->pipeline, config, fd, &client->output)) {
+        close(fd);
+        LCloseOutput(&client->output);
+        return EXIT_FAILURE;
+    }
+    client->fd = fd;
+    ETarget *target = &client->pipeline.target;
+    LOGLNIF(!gdaemon && gverbose, "Mapping to \x1b[0;37m%s\x1b[1;37m at \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;32m+\x1b[0;37m%d\x1b[1;32m+\x1b[0;37m%d\x1b[1;37m.",
+        target->spec, target->rect.width, target->rect.height, target->rect.x, target->rect.y);
+
+    /* Monotonic timestamps can be compared with the time the output finished. */
+    int clock_id = CLOCK_MONOTONIC;
+    client->pipeline.clock = ioctl(fd, EVIOCSCLOCKID, &clock_id) ? CLOCK_REALTIME : CLOCK_MONOTONIC;
+    client->pipeline.stats = LOpenStats(client->profile, 1);
+    WARNLNIF(client->pipeline.stats == NULL && !gdaemon && gverbose, "Couldn't create the statistics.");
+
+    if (!config->use_defaults) {
+        client->device = disable_defaults(config, fd, client->output.display, &client->grabbed);
+        LOGLNIF(!gdaemon && gverbose, "Default touchpad behavior => \x1b[0;37m%s",
+            client->grabbed ? "grabbed" : client->device != NULL ? "disabled on X" : "kept");
+    }
+
+    if (LHotplugInit(&client->hotplug, fd))
+        WARNLNIF(!gdaemon && gverbose, "Couldn't watch for the device, it won't be reattached.");
+
+    if (!gdaemon && gverbose) {
+        client->log = aligned_alloc(_Alignof(ELog), sizeof(ELog));
+        if (client->log != NULL)
+            LLogInit(client->log, client->profile);
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Watches the device, display, hotplug and requests of the `client` in the `loop`.
+ */
+static int add_client(EClient *client, ELoop *loop)
+{
+    if (LLoopAdd(loop, client->fd, input_callback, client) < 0)
+        return EXIT_FAILURE;
+
+    Display *display = client->output.display;
+    if (display != NULL)
+        LLoopAdd(loop, ConnectionNumber(display), display_callback, client);
+    if (client->hotplug.fd >= 0)
+        LLoopAdd(loop, client->hotplug.fd, hotplug_callback, client);
+    if (LLoopAdd(loop, client->wake_fd, wake_callback, client) < 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Prints the statistics of the `client` and gives its device back.
+ */
+static void close_client(EClient *client)
+{
+    free(client->log);
+
+    if (client->pipeline.stats != NULL && !gdaemon && gverbose) {
+        PRINTLN("---===%s===---", client->profile);
+        LPrintStats(client->pipeline.stats);
+    }
+    LCloseStats(client->pipeline.stats);
+
+    LPipelineRelease(&client->pipeline);
+    LHotplugClose(&client->hotplug);
+    if (client->fd >= 0)
+        close(client->fd);
+    if (client->device != NULL) {
+        LSetXDeviceEnabled(client->output.display, client->device, 1);
+        XCloseDevice(client->output.display, client->device);
+    }
+    LPipelineClose(&client->pipeline);
+    LCloseOutput(&client->output);
+    CFreeConfig(&client->config);
+    if (client->wake_fd >= 0) {
+        close(client->wake_fd);
+        sem_destroy(&client->done);
+    }
+}
+
+/*
+ * Gives the hot path of the calling thread the realtime guarantees of `config`.
+ * Returns the guarantees that were given.
+ */
+static int apply_realtime(EConfig *config)
+{
+    int realtime = LApplyRealtime(config);
+    WARNLNIF(config->realtime && !(realtime & REALTIME_SCHED) && !gdaemon && gverbose,
+        "Couldn't get realtime scheduling, see RLIMIT_RTPRIO or CAP_SYS_NICE.");
+    return realtime;
+}
+
+/*
+ * Locks the memory of the `daemon` if `config` or any of its devices asks for realtime guarantees.
+ * Must be called once every thread and display connection is set up, later mappings would fail under the limit.
+ */
+static void lock_memory(EDaemon *daemon, EConfig *config)
+{
+    int realtime = config->realtime;
+    for (int i = 0; i < daemon->count; i++)
+        realtime |= daemon->clients[i].config.realtime;
+    if (!realtime)
+        return;
+
+    int locked = LLockMemory();
+    WARNLNIF(!locked && !gdaemon && gverbose, "Couldn't lock the memory, see RLIMIT_MEMLOCK.");
+    for (int i = 0; i < daemon->count; i++) {
+        if (daemon->clients[i].pipeline.stats != NULL)
+            atomic_fetch_or(&daemon->clients[i].pipeline.stats->realtime, locked);
+    }
+}
+
+/*
+ * Starts the printer of the verbose output of the devices of the `daemon`, to show each on lines of its own.
+ * The devices go without it if the printer can't be started.
+ */
+static void start_printer(EDaemon *daemon)
+{
+    ELog *logs[CLIENT_MAX_DEVICES];
+    int count = 0;
+    for (int i = 0; i < daemon->count; i++) {
+        if (daemon->clients[i].log != NULL)
+            logs[count++] = daemon->clients[i].log;
+    }
+    if (!count || !LLogStart(&daemon->printer, logs, count))
+        return;
+
+    /* Nothing reads the rings then, they only fill up and drop what comes next. */
+    WARNLNIF(!gdaemon && gverbose, "Couldn't start printing the input.");
+}
+
+/*
+ * Runs the loop of the devices of the input thread in `data`, with its realtime guarantees.
+ */
+static void *input_thread(void *data)
+{
+    EInput *input = data;
+    ELoop loop;
+    int failed = LLoopInit(&loop);
+    for (int i = 0; !failed && i < input->count; i++)
+        failed = add_client(&input->clients[i], &loop);
+
+    /* A failed loop fails the first device, the input client reports it once every thread has ended. */
+    if (failed) {
+        ERRLN("Couldn't set up the event loop of \x1b[;m%s", input->clients[0].profile);
+        input->clients[0].status = EXIT_FAILURE;
+    } else {
+        int realtime = apply_realtime(input->config);
+        for (int i = 0; i < input->count; i++) {
+            if (input->clients[i].pipeline.stats != NULL)
+                atomic_fetch_or(&input->clients[i].pipeline.stats->realtime, realtime);
+        }
+        if (LLoopRun(&loop))
+            input->clients[0].status = EXIT_FAILURE;
+    }
+    LLoopClose(&loop);
+
+    /* The input client stops once every device has stopped, whether it was asked to or failed. */
+    uint64_t one = 1;
+    for (int i = 0; i < input->count; i++)
+        input->clients[i].running = 0;
+    if (write(input->exit_fd, &one, sizeof(one)) != sizeof(one))
+        input->clients[0].status = EXIT_FAILURE;
+    return NULL;
+}
+
+/*
+ * Starts the input threads of the `daemon`, one for every device or one for all of them
+ * with the realtime guarantees of the main `config`.
+ * The loop of the main thread only runs the control socket and the configuration.
+ */
+static int start_clients(EDaemon *daemon, ELoop *loop, EConfig *config)
+{
+    daemon->exit_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (daemon->exit_fd < 0 || LLoopAdd(loop, daemon->exit_fd, exit_callback, daemon) < 0)
+        return EXIT_FAILURE;
+
+    for (int i = 0; i < daemon->count; i++) {
+        EClient *client = &daemon->clients[i];
+        if (sem_init(&client->done, 0, 0))
+            return EXIT_FAILURE;
+        client->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (client->wake_fd < 0) {
+            sem_destroy(&client->done);
+            return EXIT_FAILURE;
+        }
+    }
+
+    int per_thread = daemon->threads ? 1 : daemon->count;
+    for (int i = 0; i < daemon->count; i += per_thread) {
+        EInput *input = &daemon->inputs[daemon->input_count];
+        input->clients = &daemon->clients[i];
+        input->count = per_thread;
+        input->config = daemon->threads ? &daemon->clients[i].config : config;
+        input->exit_fd = daemon->exit_fd;
+
+        for (int j = 0; j < input->count; j++)
+            input->clients[j].running = 1;
+        if (pthread_create(&input->thread, NULL, input_thread, input)) {
+            for (int j = 0; j < input->count; j++)
+                input->clients[j].running = 0;
+            return EXIT_FAILURE;
+        }
+        input->joinable = 1;
+        daemon->input_count++;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Stops the input threads of the `daemon` and waits for them to end.
+ */
+static void stop_clients(EDaemon *daemon)
+{
+    for (int i = 0; i < daemon->input_count; i++) {
+        EInput *input = &daemon->inputs[i];
+        if (!input->joinable)
+            continue;
+
+        /* Any device of the thread stops its whole loop. */
+        EClient *client = &input->clients[0];
+        EControlResponse response;
+        EClientRequest request = {.command = CONTROL_STOP, .response = &response};
+        uint64_t one = 1;
+        client->request = &request;
+        if (client->running && write(client->wake_fd, &one, sizeof(one)) == sizeof(one))
+            wait_request(client);
+        pthread_join(input->thread, NULL);
+        client->request = NULL;
+        input->joinable = 0;
+    }
+}
+
+/*
+ * Input client for GNU/Linux.
+ */
+int LInputClient(int verbose)
+{
+    gverbose = verbose;
+
+    EConfig config = CGetConfig();
+    if (config.error) {
+        if (!CConfigExists("abstouch-nux")) {
+            ERRLN("abstouch-nux has not been set up.");
+            LOGLN("See: \x1b[;mabstouch setup");
+        } else
+            ERRLN("Couldn't get the abstouch-nux configuration.");
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
 
-        int cx = window_attributes.width * (x - x_min) / (x_max - x_min);
-        int cy = window_attributes.height * (y - y_min) / (y_max - y_min);
-        XWarpPointer(display, None, root_window, 0, 0, 0, 0, cx, cy);
-        XFlush(display);
-        if (!gdaemon && gverbose) {
-            CUP(1);
-            LCLEAR();
-            SUCCESSLN("Moved cursor to \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m.", cx, cy);
+    static EDaemon daemon;
+    memset(&daemon, 0, sizeof(daemon));
+    daemon.status = EXIT_SUCCESS;
+    daemon.threads = config.threads;
+    daemon.control_fd = -1;
+    daemon.config_fd = -1;
+    daemon.exit_fd = -1;
+
+    /* Each thread talks to a display connection of its own, Xlib has to lock them anyway. */
+    if (daemon.threads)
+        XInitThreads();
+
+    /* Every device is a profile of its own, the main configuration lists them. */
+    char *profiles = malloc(strlen(config.devices) + 1);
+    strcpy(profiles, config.devices);
+    char *save;
+    for (char *profile = strtok_r(profiles, ", ", &save); profile != NULL; profile = strtok_r(NULL, ", ", &save)) {
+        if (daemon.count == CLIENT_MAX_DEVICES) {
+            WARNLNIF(!gdaemon && gverbose, "Only the first \x1b[0;37m%d\x1b[1;37m devices are served.", CLIENT_MAX_DEVICES);
+            break;
         }
+        if (open_client(&daemon.clients[daemon.count], profile)) {
+            CFreeConfig(&daemon.clients[daemon.count].config);
+            WARNLNIF(!gdaemon && gverbose, "Skipped the device of \x1b[;m%s", profile);
+            continue;
+        }
+        daemon.count++;
+    }
+    free(profiles);
+    if (!daemon.count) {
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
     }
 
-    LSetXDeviceEnabled(display, device, 1);
-    return EXIT_SUCCESS;
+    daemon.control_fd = LControlListen();
+    WARNLNIF(daemon.control_fd < 0 && !gdaemon && gverbose, "Couldn't create the control socket.");
+
+    daemon.config_fd = watch_config();
+
+    /* The signals are blocked before the input threads start, so only this loop receives them. */
+    ELoop loop;
+    if (LLoopInit(&loop) || LLoopAddSignals(&loop, signal_callback, &daemon) < 0 || start_clients(&daemon, &loop, &config)) {
+        ERRLN("Couldn't set up the event loop.");
+        daemon.status = EXIT_FAILURE;
+    } else {
+        if (daemon.control_fd >= 0)
+            LLoopAdd(&loop, daemon.control_fd, control_callback, &daemon);
+        if (daemon.config_fd >= 0)
+            LLoopAdd(&loop, daemon.config_fd, config_callback, &daemon);
+
+        /* Every thread is set up with the printer, so the hot path can be locked in memory now. */
+        start_printer(&daemon);
+        lock_memory(&daemon, &config);
+
+        LOGLNIF(!gdaemon && gverbose, "Waiting for input...\n");
+        LLogShow(&daemon.printer);
+        if (LLoopRun(&loop))
+            daemon.status = EXIT_FAILURE;
+    }
+    stop_clients(&daemon);
+    LLogStop(&daemon.printer);
+    LLoopClose(&loop);
+
+    LControlClose(daemon.control_fd);
+    if (daemon.config_fd >= 0)
+        close(daemon.config_fd);
+    for (int i = 0; i < daemon.count; i++) {
+        daemon.status |= daemon.clients[i].status;
+        close_client(&daemon.clients[i]);
+    }
+    if (daemon.exit_fd >= 0)
+        close(daemon.exit_fd);
+    CFreeConfig(&config);
+    return daemon.status;
 }
 
 /*
@@ -186,11 +1010,6 @@ int LInputClientDaemon(int verbose)
     gdaemon = 1;
     gverbose = verbose;
 
-    char *dir = CGetConfigDir();
-    char path[strlen(dir) + strlen("/daemon.conf") + 1];
-    snprintf(path, sizeof(path), "%s/daemon.conf", dir);
-    free(dir);
-
     int restart = 0;
     restart = !LStopInputClientDaemon();
 
@@ -203,10 +1022,6 @@ int LInputClientDaemon(int verbose)
     }
 
     if (daemon_pid > 0) {
-        FILE *f = fopen(path, "w");
-        fprintf(f, "pid=%d\n", daemon_pid);
-        fclose(f);
-
         if (verbose) {
             SUCCESSLNIF(restart, "Restarted the abstouch-nux daemon.");
             SUCCESSLNIF(!restart, "Started the abstouch-nux daemon.");
@@ -223,222 +1038,663 @@ int LInputClientDaemon(int verbose)
  */
 int LStopInputClientDaemon(void)
 {
-    char *dir = CGetConfigDir();
-    char path[strlen(dir) + strlen("/daemon.conf") + 1];
-    snprintf(path, sizeof(path), "%s/daemon.conf", dir);
-    free(dir);
+    EControlResponse response;
+    if (LControlSend(CONTROL_STOP, NULL, CONTROL_ALL_DEVICES, &response, NULL))
+        return EXIT_FAILURE;
+    return response.status;
+}
+
+/*
+ * Sends the control `command` with `argument` for the device at index `device`, or for every device,
+ * to the running input client for GNU/Linux.
+ */
+int LControlInputClient(int command, char *argument, int device, int verbose)
+{
+    EControlResponse response;
+    if (LControlSend(command, argument, device, &response, NULL)) {
+        ERRLNIF(verbose, "Couldn't find the running abstouch-nux input client.");
+        return EXIT_FAILURE;
+    }
 
-    if (CConfigExists("daemon")) {
-        char key[256], val[256];
-        char *p;
-        pid_t pid = 0;
+    if (response.status) {
+        ERRLNIF(verbose && command == CONTROL_PROFILE, "Couldn't switch to the profile \x1b[;m%s", argument);
+        ERRLNIF(verbose && command != CONTROL_PROFILE, "Couldn't reload the configuration.");
+        return EXIT_FAILURE;
+    }
 
-        FILE *f = fopen(path, "r");
-        while (fscanf(f, "%255[^=]=%255[^\n]%*c", key, val) == 2) {
-            if (!strcmp(key, "pid"))
-                pid = (int) strtol(val, &p, 10);
-        }
-        fclose(f);
-
-        char name[1024];
-        snprintf(name, sizeof(name), "/proc/%d/cmdline", pid);
-        f = fopen(name, "r");
-        if (f != NULL) {
-            size_t size = fread(name, sizeof(char), 1024, f);
-            name[size - 1] = '\0';
-            fclose(f);
-
-            if (strcasestr(name, "abstouch") != NULL) {
-                kill(pid, SIGTERM);
-                return remove(path);
+    if (!verbose)
+        return EXIT_SUCCESS;
+
+    switch (command) {
+        case CONTROL_RELOAD:
+            SUCCESSLN("Reloaded the configuration.");
+            break;
+        case CONTROL_PAUSE:
+            SUCCESSLN("Paused the abstouch-nux input client.");
+            break;
+        case CONTROL_RESUME:
+            SUCCESSLN("Resumed the abstouch-nux input client.");
+            break;
+        case CONTROL_PROFILE:
+            SUCCESSLN("Switched to the profile \x1b[;m%s", response.profile);
+            break;
+        default:
+            LOGLN("Client \x1b[0;37m%d\x1b[1;37m with \x1b[0;37m%d\x1b[1;37m device(s).", response.pid, response.devices);
+            for (int i = 0; i < response.devices; i++) {
+                if ((device != CONTROL_ALL_DEVICES && i != device) || LControlSend(command, argument, i, &response, NULL))
+                    continue;
+
+                LOGLN("Device \x1b[0;37m%d\x1b[1;37m => \"\x1b[0;37m%s\x1b[1;37m\" on event \x1b[0;37m%d\x1b[1;37m (%s, %s)", i, response.profile,
+                    response.event, response.paused ? "paused" : "running", response.attached ? "attached" : "waiting for the device");
             }
-        }
+            break;
     }
 
-    return EXIT_FAILURE;
+    return EXIT_SUCCESS;
 }
+
 /*
- * Calibrate the touchpad and set the configuration about limits on GNU/Linux.
+ * Returns the configuration of `profile`, telling why if it has an error.
  */
-int LCalibrate(int visual)
+static EConfig calibration_config(char *profile)
 {
-    EConfig config = CGetConfig();
+    EConfig config = CGetProfile(profile);
     if (config.error) {
         if (!CConfigExists("abstouch-nux")) {
             ERRLN("abstouch-nux has not been set up.");
             LOGLN("See: \x1b[;mabstouch setup");
         } else
-            ERRLN("Couldn't get the abstouch-nux configuration.");
-        return EXIT_FAILURE;
+            ERRLN("Couldn't get the configuration \x1b[;m%s", profile);
     }
+    return config;
+}
 
-    int fd = LOpenEvent(config.event);
-    if (fd < 0)
-        return EXIT_FAILURE;
+/*
+ * Gives the touchpad on `fd` its default behavior back after a calibration,
+ * re-enabling the XInput `device` unless it was `grabbed`, and closes `fd` and `display`.
+ */
+static void release_touchpad(int fd, Display *display, XDevice *device, int grabbed)
+{
+    if (grabbed)
+        LGrabEvent(fd, 0);
+    if (device != NULL) {
+        LSetXDeviceEnabled(display, device, 1);
+        XCloseDevice(display, device);
+    }
+    close(fd);
+    if (display != NULL)
+        XCloseDisplay(display);
+}
 
-    if (!LIsAbsoluteEvent(config.event)) {
-        int newevent = LGetEventByName(config.event_name);
-        if (newevent < 0 || !LIsAbsoluteEvent(newevent)) {
-            ERRLN("Event has no absolute input.");
-            return EXIT_FAILURE;
+/*
+ * Struct that holds the state of the running calibration.
+ */
+typedef struct {
+    int visual;
+    int status;
+    int dirty;
+
+    EFrameAssembler assembler;
+    ECalibration calibration;
+
+    EVisual box;
+} ECalibrator;
+
+/*
+ * Works out the current limits of the calibration `c`, or the extremes of the samples
+ * while there are too few of them. Returns the coverage of the limits in percent.
+ */
+static int calibrator_limits(ECalibrator *c, int *x_min, int *y_min, int *x_max, int *y_max)
+{
+    if (LCalibrationLimits(&c->calibration, x_min, y_min, x_max, y_max)) {
+        *x_min = c->calibration.x.low;
+        *x_max = c->calibration.x.high;
+        *y_min = c->calibration.y.low;
+        *y_max = c->calibration.y.high;
+    }
+    return round(LCalibrationCoverage(&c->calibration, *x_min, *y_min, *x_max, *y_max) * 100);
+}
+
+/*
+ * Counts the samples of the complete frames whenever the device is readable.
+ */
+static void calibrate_callback(ELoop *loop, int fd, void *data)
+{
+    ECalibrator *c = data;
+
+    /* Every frame is counted, the latest one alone would drop samples at high rates. */
+    struct input_event ev[64];
+    for (;;) {
+        int rd = read(fd, ev, sizeof(ev));
+        if (rd < 0 && errno == EAGAIN)
+            return;
+        if (rd < (int) sizeof(struct input_event)) {
+            c->status = EXIT_FAILURE;
+            LLoopStop(loop);
+            return;
         }
 
-        config.event = newevent;
-        CSetConfig(config);
-        fd = LOpenEvent(newevent);
-        if (fd < 0)
-            return EXIT_FAILURE;
+        for (int i = 0; i < rd / (int) sizeof(struct input_event); i++) {
+            if (!LFramePush(&c->assembler, &ev[i]) || !LCalibrationSample(&c->calibration, &c->assembler.frame))
+                continue;
+
+            c->dirty = 1;
+            if (c->visual)
+                LVisualSample(&c->box, c->assembler.frame.x, c->assembler.frame.y);
+        }
+    }
+}
+
+/*
+ * Shows the limits with the samples since the last update.
+ */
+static void status_callback(ELoop *loop, int expirations, void *data)
+{
+    ECalibrator *c = data;
+    if (!c->dirty)
+        return;
+    c->dirty = 0;
+
+    int x_min, y_min, x_max, y_max;
+    int coverage = calibrator_limits(c, &x_min, &y_min, &x_max, &y_max);
+    if (c->visual) {
+        LVisualDraw(&c->box, x_min, y_min, x_max, y_max, coverage);
+        return;
+    }
+
+    CUP(1);
+    LCLEAR();
+    LOGLN("Press Ctrl + C to end the calibration. \t \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d - \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m, \x1b[0;37m%d%%\x1b[1;37m covered.",
+        x_min, y_min, x_max, y_max, coverage);
+    fflush(stdout);
+}
+
+/*
+ * Calibrates the limits of the touchpad in `config` and saves them.
+ */
+static int calibrate(EConfig *config, int visual)
+{
+    int fd = LOpenConfiguredEvent(config);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    LOGLN("Found absolute input on event \x1b[;m%d\x1b[1;37m.", config->event);
+
+    static ECalibrator c;
+    memset(&c, 0, sizeof(c));
+    c.visual = visual;
+    c.status = EXIT_SUCCESS;
+    if (LCalibrationInit(&c.calibration, fd, config)) {
+        close(fd);
+        return EXIT_FAILURE;
     }
-    LOGLN("Found absolute input on event \x1b[;m%d\x1b[1;37m.", config.event);
 
-    Display *display = XOpenDisplay(config.display);
+    Display *display = XOpenDisplay(config->display);
     WARNLNIF(LIsXWayland(display), "Running on XWayland. All features might not be available.");
     if (LIsXWayland(display)) {
         ERRLN("XWayland is currently not supported for input.");
+        release_touchpad(fd, display, NULL, 0);
         return EXIT_FAILURE;
     }
 
-    XDevice *device = LOpenXDevice(display, config.event_name);
-    LSetXDeviceEnabled(display, device, 0);
-
-    int new_x_min = 65536, new_x_max = -65535;
-    int new_y_min = 65536, new_y_max = -65535;
-    int new_x_size = 0, new_y_size = 0;
+    /* A running input client would keep the events to itself. */
+    uint32_t paused;
+    if (LControlTakeEvent(config->event, fd, &paused)) {
+        release_touchpad(fd, display, NULL, 0);
+        return EXIT_FAILURE;
+    }
 
-    struct input_event ev[64];
-    int rd;
-    fd_set rdfs;
-    FD_ZERO(&rdfs);
-    FD_SET(fd, &rdfs);
-    int x, y;
-    
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    int grabbed;
+    XDevice *device = disable_defaults(config, fd, display, &grabbed);
+
+    /* Palms are rejected like while running, so they don't widen the limits. */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    LFrameInit(&c.assembler, fd);
+    LFrameConfigure(&c.assembler, config);
+
+    /* The status is only redrawn as often as a terminal can show it, however fast the input is. */
+    ELoop loop;
+    if (LLoopInit(&loop) || LLoopAddSignals(&loop, signal_callback, NULL) < 0
+        || LLoopAdd(&loop, fd, calibrate_callback, &c) < 0
+        || LLoopAddTimer(&loop, 1000 / VISUAL_RATE_HZ, status_callback, &c) < 0) {
+        ERRLN("Couldn't set up the event loop.");
+        LLoopClose(&loop);
+        release_touchpad(fd, display, device, grabbed);
+        LControlResumeEvent(paused);
+        return EXIT_FAILURE;
+    }
 
     if (visual) {
         LOGLN("Rub the touchpad until the visualization works correctly.");
-        PRINT("\n\n\n\n\n"
-              "          +--+\n"
-              "          |  |\n"
-              "          +--+\n"
-              "\n\n\n\n\n");
-    }
-
-    int edited = 0;
-    LOGLN("Waiting for input...");
-    while (!stop) {
-        select(fd + 1, &rdfs, NULL, NULL, NULL);
-        if (stop)
-            break;
-        rd = read(fd, ev, sizeof(ev));
+        LVisualInit(&c.box, fd);
+    } else
+        LOGLN("Waiting for input...");
 
-        if (rd < (int) sizeof(struct input_event))
-            return EXIT_FAILURE;
-        
-        for (int i = 0; i < rd / sizeof(struct input_event); i++) {
-            unsigned int type, code;
-            type = ev[i].type;
-            code = ev[i].code;
+    LLoopRun(&loop);
+    LLoopClose(&loop);
+    status_callback(&loop, 0, &c);
+    release_touchpad(fd, display, device, grabbed);
 
-            if (type != EV_ABS)
-                continue;
+    /* The resumed client picks up the new limits once they are saved. */
+    LControlResumeEvent(paused);
+    if (c.status)
+        return c.status;
 
-            if (code == ABS_X) {
-                x = ev[i].value;
-                continue;
-            } else if (code == ABS_Y) {
-                y = ev[i].value;
-                continue;
-            }
-        }
+    if (!c.calibration.samples) {
+        printf("\x1b[255D\x1b[K \x1b[1;32m=> \x1b[1;37mCancelled calibration.\x1b[;m\n");
+        return EXIT_SUCCESS;
+    }
 
-        if (x < new_x_min) new_x_min = x;
-        if (x > new_x_max) new_x_max = x;
-        if (y < new_y_min) new_y_min = y;
-        if (y > new_y_max) new_y_max = y;
+    int x_min, y_min, x_max, y_max;
+    if (LCalibrationLimits(&c.calibration, &x_min, &y_min, &x_max, &y_max)) {
+        ERRLNCLEAR("Not enough samples to calibrate, rub the whole area for longer.");
+        return EXIT_FAILURE;
+    }
 
-        new_x_size = new_x_max - new_x_min;
-        new_y_size = new_y_max - new_y_min;
+    double coverage = LCalibrationCoverage(&c.calibration, x_min, y_min, x_max, y_max);
+    double confidence = LCalibrationConfidence(&c.calibration, coverage);
+    LOGLNCLEAR("Took \x1b[0;37m%llu\x1b[1;37m samples, left out \x1b[0;37m%llu\x1b[1;37m, covered \x1b[0;37m%d%%\x1b[1;37m with \x1b[0;37m%d%%\x1b[1;37m confidence.",
+        (unsigned long long) c.calibration.samples, (unsigned long long) c.calibration.rejected,
+        (int) round(coverage * 100), (int) round(confidence * 100));
+    WARNLNIF(confidence < 0.5, "The calibration might be off, rub the whole area evenly for better limits.");
 
-        if (new_x_min == 65536 || new_x_max == -65535 || new_y_min == 65536 || new_y_max == -65535)
-            continue;
+    config->x_min = x_min;
+    config->x_max = x_max;
+    config->y_min = y_min;
+    config->y_max = y_max;
+    strcpy(config->homography, "none");
 
-        edited = 1;
-        if (!visual) {
-            CUP(1);
-            LCLEAR();
-            LOGLN("Press Ctrl + C to end the calibration. \t \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d - \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d", new_x_min, new_y_min, new_x_max, new_y_max);    
-            continue;
-        }
+    /* The table was measured through the old mapping, it would move the positions the wrong way now. */
+    int corrected = config->correction;
+    config->correction = 0;
+    CSetConfig(*config);
 
-        double ratio = (double) new_x_size / (double) new_y_size;
-        if (ratio > 3)
-            ratio = 3;
-        else if (ratio < 0)
-            ratio = 0;
+    SUCCESSLNCLEAR("Successfully calibrated.");
+    LOGLNIF(corrected, "Turned the correction table off, see: \x1b[;mabstouch calibrate --grid");
+    return EXIT_SUCCESS;
+}
 
-        int height = 10;
-        int width = round(ratio) * height;
-        if (width <= 0)
-            continue;
+/*
+ * Calibrate the touchpad of `profile` and set the configuration about limits on GNU/Linux.
+ */
+int LCalibrate(char *profile, int visual)
+{
+    EConfig config = calibration_config(profile);
+    int status = config.error ? EXIT_FAILURE : calibrate(&config, visual);
+    CFreeConfig(&config);
+    return status;
+}
 
-        if (x == new_x_min || y == new_y_min)
-            continue;
+/*
+ * Frames a touch needs to be taken as a point, shorter ones are taken as accidental.
+ */
+#define TOUCH_MIN_FRAMES 5
 
-        if ((new_x_max - new_x_min) == 0)
-            new_x_max += 1;
-        if ((new_y_max - new_y_min) == 0)
-            new_y_max += 1;
+typedef struct ETouchCollector ETouchCollector;
 
-        int pos_x = round((x - new_x_min) / ((new_x_max - new_x_min) / width));
-        int pos_y = height - round((y - new_y_min) / ((new_y_max - new_y_min) / height));
-        CUP(1);
-        for (int i = 0; i < height + 2; i++) {
-            CUP(1);
-            PRINTCLEAR(" ");
-            if (i == 0 || i == (height + 1)) {
-                PRINT("+");
-                for (int j = 0; j < width; j++)
-                    PRINT("--");
-                PRINT("+");
+/*
+ * Struct that holds the state of a calibration by touched points.
+ * `prompt` is called before each point and once more after the last one.
+ */
+struct ETouchCollector {
+    int status;
+
+    EFrameAssembler assembler;
+    EConfig *config;
+
+    int count, wanted;
+    double points[CORRECTION_MAX_NODES * CORRECTION_MAX_NODES][2];
+
+    /* Size of the screen the points were touched for, empty without a display. */
+    ERect screen;
+
+    /* Sum of the positions of the current touch. */
+    double sum_x, sum_y;
+    int frames;
+
+    void (*prompt)(ETouchCollector *collector);
+};
+
+/*
+ * Takes the average position of each touch as the next point whenever the device is readable.
+ */
+static void touch_callback(ELoop *loop, int fd, void *data)
+{
+    ETouchCollector *c = data;
+
+    struct input_event ev[64];
+    for (;;) {
+        int rd = read(fd, ev, sizeof(ev));
+        if (rd < 0 && errno == EAGAIN)
+            return;
+        if (rd < (int) sizeof(struct input_event)) {
+            c->status = EXIT_FAILURE;
+            LLoopStop(loop);
+            return;
+        }
+
+        for (int i = 0; i < rd / (int) sizeof(struct input_event); i++) {
+            if (!LFramePush(&c->assembler, &ev[i]))
+                continue;
+
+            EFrame *frame = &c->assembler.frame;
+            if (frame->contacts > 0 && !frame->rejected) {
+                c->sum_x += frame->x;
+                c->sum_y += frame->y;
+                c->frames++;
                 continue;
             }
 
-            PRINT("|");
-            for (int j = 0; j < width; j++) {
-                if (i == pos_y && j == pos_x) {
-                    PRINT("**");
-                    continue;
+            /* The point is taken when the finger is lifted. */
+            if (c->frames >= TOUCH_MIN_FRAMES) {
+                c->points[c->count][0] = c->sum_x / c->frames;
+                c->points[c->count][1] = c->sum_y / c->frames;
+                c->count++;
+                c->prompt(c);
+                fflush(stdout);
+                if (c->count == c->wanted) {
+                    LLoopStop(loop);
+                    return;
                 }
-                printf("  ");
             }
-            PRINT("|");
+            c->sum_x = c->sum_y = 0;
+            c->frames = 0;
         }
-        for (int i = 0; i < height + 2; i++)
-            printf("\n");
-        printf("\x1b[;m\n");
+    }
+}
+
+/*
+ * Collects the `wanted` points of the `collector` from the device in `config` until they are all touched or interrupted.
+ */
+static int collect_touches(EConfig *config, ETouchCollector *c, int wanted)
+{
+    int fd = LOpenConfiguredEvent(config);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    LOGLN("Found absolute input on event \x1b[;m%d\x1b[1;37m.", config->event);
 
+    Display *display = XOpenDisplay(config->display);
+    if (LIsXWayland(display)) {
+        ERRLN("XWayland is currently not supported for input.");
+        release_touchpad(fd, display, NULL, 0);
+        return EXIT_FAILURE;
+    }
+
+    /* A running input client would keep the events to itself. */
+    uint32_t paused;
+    if (LControlTakeEvent(config->event, fd, &paused)) {
+        release_touchpad(fd, display, NULL, 0);
+        return EXIT_FAILURE;
+    }
+
+    int grabbed;
+    XDevice *device = disable_defaults(config, fd, display, &grabbed);
+
+    c->status = EXIT_SUCCESS;
+    c->config = config;
+    c->count = 0;
+    c->wanted = wanted;
+    if (display != NULL) {
+        c->screen.width = DisplayWidth(display, DefaultScreen(display));
+        c->screen.height = DisplayHeight(display, DefaultScreen(display));
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    LFrameInit(&c->assembler, fd);
+    LFrameConfigure(&c->assembler, config);
+
+    ELoop loop;
+    if (LLoopInit(&loop) || LLoopAddSignals(&loop, signal_callback, NULL) < 0
+        || LLoopAdd(&loop, fd, touch_callback, c) < 0) {
+        ERRLN("Couldn't set up the event loop.");
+        LLoopClose(&loop);
+        release_touchpad(fd, display, device, grabbed);
+        LControlResumeEvent(paused);
+        return EXIT_FAILURE;
+    }
+
+    LOGLN("Press Ctrl + C to cancel the calibration.");
+    c->prompt(c);
+    fflush(stdout);
+    LLoopRun(&loop);
+    LLoopClose(&loop);
+    release_touchpad(fd, display, device, grabbed);
+    LControlResumeEvent(paused);
+    return c->status;
+}
+
+/*
+ * Names of the corners in the order they are touched.
+ */
+static const char *corner_names[] = {"top left", "top right", "bottom right", "bottom left"};
+
+/*
+ * Tells where the last corner was taken and which one to touch next.
+ */
+static void corner_prompt(ETouchCollector *c)
+{
+    if (c->count > 0) {
         CUP(1);
-        LOGLNCLEAR("Press Ctrl + C to end the calibration. \t \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d - \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d", new_x_min, new_y_min, new_x_max, new_y_max);
+        SUCCESSLNCLEAR("Took the %s corner at \x1b[0;37m%.0f\x1b[1;32mx\x1b[0;37m%.0f\x1b[1;37m.", corner_names[c->count - 1],
+            c->points[c->count - 1][0], c->points[c->count - 1][1]);
     }
+    if (c->count < 4)
+        LOGLN("Touch where the \x1b[;m%s\x1b[1;37m corner of the screen should be, then lift the finger.", corner_names[c->count]);
+}
+
+/*
+ * Calibrates the homography of the touchpad in `config` with four touched corners and saves it.
+ */
+static int calibrate_corners(EConfig *config)
+{
+    static ETouchCollector c;
+    memset(&c, 0, sizeof(c));
+    c.prompt = corner_prompt;
+    if (collect_touches(config, &c, 4))
+        return EXIT_FAILURE;
 
-    if (!edited) {
+    if (c.count < 4) {
+        printf("\x1b[255D\x1b[K \x1b[1;32m=> \x1b[1;37mCancelled calibration.\x1b[;m\n");
+        return EXIT_SUCCESS;
+    }
+
+    /* The corners go to the corners of the target in the same order. */
+    static const double corners[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    double h[9];
+    if (TSolveHomography(c.points, corners, h)) {
+        ERRLN("The corners don't make a convex area, calibrate again touching them in order.");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(config->homography, CONFIG_VALUE_SIZE, "%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g,%.10g",
+        h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], h[8]);
+
+    /* The limits cover the touched area, for anything that still goes by them. */
+    config->x_min = config->x_max = c.points[0][0];
+    config->y_min = config->y_max = c.points[0][1];
+    for (int i = 1; i < 4; i++) {
+        if (c.points[i][0] < config->x_min) config->x_min = c.points[i][0];
+        if (c.points[i][0] > config->x_max) config->x_max = c.points[i][0];
+        if (c.points[i][1] < config->y_min) config->y_min = c.points[i][1];
+        if (c.points[i][1] > config->y_max) config->y_max = c.points[i][1];
+    }
+
+    /* The table was measured through the old mapping, it would move the positions the wrong way now. */
+    int corrected = config->correction;
+    config->correction = 0;
+    CSetConfig(*config);
+
+    /* Whether the perspective is worth dividing for depends on the size it is mapped to, the screen tells best. */
+    if (c.screen.width > 0) {
+        double error = THomographyAffineError(h, c.screen, config->x_min, config->x_max, config->y_min, config->y_max);
+        LOGLN("Using the \x1b[;m%s\x1b[1;37m mapping on the screen, the perspective moves by up to \x1b[0;37m%.2f\x1b[1;37mpx.",
+            error <= TRANSFORM_AFFINE_ERROR ? "affine" : "projective", error);
+    }
+    SUCCESSLN("Successfully calibrated.");
+    LOGLNIF(corrected, "Turned the correction table off, see: \x1b[;mabstouch calibrate --grid");
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Calibrate the touchpad of `profile` with four touched corners and set the homography on GNU/Linux.
+ */
+int LCalibrateCorners(char *profile)
+{
+    EConfig config = calibration_config(profile);
+    int status = config.error ? EXIT_FAILURE : calibrate_corners(&config);
+    CFreeConfig(&config);
+    return status;
+}
+
+/*
+ * Draws the grid of points with the taken ones, the one to touch next and the rest,
+ * over the grid drawn for the previous point.
+ */
+static void grid_prompt(ETouchCollector *c)
+{
+    int columns = c->config->correction_columns, rows = c->config->correction_rows;
+    if (c->count > 0)
+        CUP(rows + 1);
+
+    for (int i = 0; i < rows; i++) {
+        LCLEAR();
+        printf("    ");
+        for (int j = 0; j < columns; j++) {
+            int point = i * columns + j;
+            printf("%s", point < c->count ? "\x1b[1;32m## " : point == c->count ? "\x1b[1;31m** " : "\x1b[0;37m.. ");
+        }
+        printf("\x1b[;m\n");
+    }
+
+    if (c->count < c->wanted) {
+        LOGLNCLEAR("Touch where the point marked \x1b[1;31m**\x1b[1;37m is on the screen, then lift the finger. \t \x1b[0;37m%d\x1b[1;37m/\x1b[0;37m%d",
+            c->count + 1, c->wanted);
+    } else
+        SUCCESSLNCLEAR("Took all the points.");
+}
+
+/*
+ * Builds the transform the limits or the homography in `config` make, onto a large square for precision.
+ */
+static int config_transform(EConfig *config, ETransform *transform, ERect *rect)
+{
+    ERect square = {0, 0, 1 << 16, 1 << 16};
+    *rect = square;
+    if (strcmp(config->homography, "none")) {
+        double h[9];
+        return TParseHomography(config->homography, h) || TBuildProjectiveTransform(transform, h, square,
+            config->x_min, config->x_max, config->y_min, config->y_max);
+    }
+
+    return TBuildTransform(transform, config->x_min, config->x_max, config->y_min, config->y_max,
+        square, config->orientation, config->mirror);
+}
+
+/*
+ * Calibrates the correction table of the touchpad in `config` with a grid of touched points and writes it.
+ */
+static int calibrate_grid(EConfig *config)
+{
+    int columns = config->correction_columns, rows = config->correction_rows;
+    if (columns < 2 || rows < 2 || columns > CORRECTION_MAX_NODES || rows > CORRECTION_MAX_NODES) {
+        ERRLN("The correction grid must have from \x1b[0;37m2\x1b[1;37m to \x1b[0;37m%d\x1b[1;37m columns and rows.", CORRECTION_MAX_NODES);
+        return EXIT_FAILURE;
+    }
+
+    /* The points are where the current mapping, without correction, puts the targets. */
+    ETransform transform;
+    ERect rect;
+    if (config_transform(config, &transform, &rect)) {
+        ERRLN("Calibrate the limits or the corners first.");
+        return EXIT_FAILURE;
+    }
+
+    static ETouchCollector c;
+    memset(&c, 0, sizeof(c));
+    c.prompt = grid_prompt;
+    if (collect_touches(config, &c, columns * rows))
+        return EXIT_FAILURE;
+
+    if (c.count < columns * rows) {
         printf("\x1b[255D\x1b[K \x1b[1;32m=> \x1b[1;37mCancelled calibration.\x1b[;m\n");
-        LSetXDeviceEnabled(display, device, 1);
-        XCloseDevice(display, device);
-        XCloseDisplay(display);
         return EXIT_SUCCESS;
     }
 
-    config.x_min = new_x_min;
-    config.x_max = new_x_max;
-    config.y_min = new_y_min;
-    config.y_max = new_y_max;
-    CSetConfig(config);
+    static double expected[CORRECTION_MAX_NODES * CORRECTION_MAX_NODES][2];
+    ECorrectionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORRECTION_MAGIC, sizeof(header.magic));
+    header.version = CORRECTION_VERSION;
+    header.header_size = sizeof(header);
+    header.columns = columns;
+    header.rows = rows;
+    header.x_min = header.x_max = c.points[0][0];
+    header.y_min = header.y_max = c.points[0][1];
+    for (int i = 0; i < c.count; i++) {
+        double px = (rect.x + rect.width * (double) (i % columns) / (columns - 1)) * (1 << TRANSFORM_SUBPIXEL_BITS);
+        double py = (rect.y + rect.height * (double) (i / columns) / (rows - 1)) * (1 << TRANSFORM_SUBPIXEL_BITS);
+        if (TInvertTransform(&transform, px, py, &expected[i][0], &expected[i][1])) {
+            ERRLN("Calibrate the limits or the corners first.");
+            return EXIT_FAILURE;
+        }
 
-    SUCCESSLNCLEAR("Successfully calibrated.");
-    LSetXDeviceEnabled(display, device, 1);
-    XCloseDevice(display, device);
-    XCloseDisplay(display);
+        if (c.points[i][0] < header.x_min) header.x_min = floor(c.points[i][0]);
+        if (c.points[i][0] > header.x_max) header.x_max = ceil(c.points[i][0]);
+        if (c.points[i][1] < header.y_min) header.y_min = floor(c.points[i][1]);
+        if (c.points[i][1] > header.y_max) header.y_max = ceil(c.points[i][1]);
+    }
+    if (header.x_max <= header.x_min || header.y_max <= header.y_min) {
+        ERRLN("The points don't cover an area, calibrate again touching them in order.");
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * The touched points are scattered, the nodes are spread evenly over them.
+     * Each node takes the displacements of the points weighted by their inverse squared distance.
+     */
+    static ECorrectionNode nodes[CORRECTION_MAX_NODES * CORRECTION_MAX_NODES];
+    double largest = 0;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < columns; j++) {
+            double x = header.x_min + (header.x_max - header.x_min) * (double) j / (columns - 1);
+            double y = header.y_min + (header.y_max - header.y_min) * (double) i / (rows - 1);
+            double dx = 0, dy = 0, weights = 0;
+            for (int k = 0; k < c.count; k++) {
+                double distance = pow(c.points[k][0] - x, 2) + pow(c.points[k][1] - y, 2);
+                double weight = 1 / (distance + 1e-6);
+                dx += weight * (expected[k][0] - c.points[k][0]);
+                dy += weight * (expected[k][1] - c.points[k][1]);
+                weights += weight;
+            }
+
+            dx = round(dx / weights);
+            dy = round(dy / weights);
+            if (hypot(dx, dy) > largest)
+                largest = hypot(dx, dy);
+            nodes[i * columns + j].dx = dx < INT16_MIN ? INT16_MIN : dx > INT16_MAX ? INT16_MAX : dx;
+            nodes[i * columns + j].dy = dy < INT16_MIN ? INT16_MIN : dy > INT16_MAX ? INT16_MAX : dy;
+        }
+    }
+
+    char path[4096];
+    LGetCorrectionPath(config->profile, path, sizeof(path));
+    if (LWriteCorrection(path, &header, nodes))
+        return EXIT_FAILURE;
+
+    config->correction = 1;
+    CSetConfig(*config);
+
+    LOGLN("Wrote \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m nodes to \x1b[;m%s\x1b[1;37m, moving by up to \x1b[0;37m%.0f\x1b[1;37m units.",
+        columns, rows, path, largest);
+    SUCCESSLN("Successfully calibrated.");
     return EXIT_SUCCESS;
 }
+
+/*
+ * Calibrate the touchpad of `profile` with a grid of touched points and write its correction table on GNU/Linux.
+ */
+int LCalibrateGrid(char *profile)
+{
+    EConfig config = calibration_config(profile);
+    int status = config.error ? EXIT_FAILURE : calibrate_grid(&config);
+    CFreeConfig(&config);
+    return status;
+}
@@ -36,8 +36,24 @@ int LInputClientDaemon(int verbose);
 int LStopInputClientDaemon(void);
 
 /*
- * Calibrate the touchpad and set the configuration about limits on GNU/Linux.
+ * Sends the control `command` with `argument` for the device at index `device`, or for every device,
+ * to the running input client for GNU/Linux.
  */
-int LCalibrate(int visual);
+int LControlInputClient(int command, char *argument, int device, int verbose);
+
+/*
+ * Calibrate the touchpad of `profile` and set the configuration about limits on GNU/Linux.
+ */
+int LCalibrate(char *profile, int visual);
+
+/*
+ * Calibrate the touchpad of `profile` with four touched corners and set the homography on GNU/Linux.
+ */
+int LCalibrateCorners(char *profile);
+
+/*
+ * Calibrate the touchpad of `profile` with a grid of touched points and write its correction table on GNU/Linux.
+ */
+int LCalibrateGrid(char *profile);
 
 #endif /* _LINUX_CLIENT_H */
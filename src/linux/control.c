@@ -0,0 +1,205 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "control.h"
+#include "event.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/*
+ * Writes the path of the control socket to `path`.
+ */
+int LControlPath(char *path, size_t size)
+{
+    char *dir = getenv("XDG_RUNTIME_DIR");
+    int len;
+    if (dir != NULL && dir[0] != '\0')
+        len = snprintf(path, size, "%s/%s", dir, CONTROL_SOCKET);
+    else
+        len = snprintf(path, size, "/tmp/abstouch-nux-%d.sock", getuid());
+    return len < 0 || (size_t) len >= size ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Fills `addr` with the address of the control socket.
+ */
+static int control_address(struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    return LControlPath(addr->sun_path, sizeof(addr->sun_path));
+}
+
+/*
+ * Returns a new non-blocking fd listening on the control socket, or -1.
+ * A socket left behind by a client that has exited is replaced.
+ */
+int LControlListen(void)
+{
+    struct sockaddr_un addr;
+    if (control_address(&addr))
+        return -1;
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        /* Only a socket nobody listens on anymore is taken over. */
+        int probe = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        int alive = errno == EADDRINUSE && probe >= 0
+            && connect(probe, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+        if (probe >= 0)
+            close(probe);
+        if (alive || unlink(addr.sun_path) < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, 8) < 0) {
+        LControlClose(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * Removes the control socket listening on `fd`.
+ */
+void LControlClose(int fd)
+{
+    if (fd < 0)
+        return;
+
+    struct sockaddr_un addr;
+    if (!control_address(&addr))
+        unlink(addr.sun_path);
+    close(fd);
+}
+
+/*
+ * Sends the `command` with `argument` for the device at index `device` to the running input client
+ * and waits for its `response`. `stats` receives the snapshot of the statistics if it isn't NULL.
+ * Returns EXIT_FAILURE if no input client is running.
+ */
+int LControlSend(int command, char *argument, int device, EControlResponse *response, EStats *stats)
+{
+    struct sockaddr_un addr;
+    if (control_address(&addr))
+        return EXIT_FAILURE;
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return EXIT_FAILURE;
+
+    struct timeval timeout = {CONTROL_TIMEOUT / 1000, (CONTROL_TIMEOUT % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    EControlRequest request = {.magic = CONTROL_MAGIC, .version = CONTROL_VERSION, .command = command, .device = device};
+    if (argument != NULL)
+        snprintf(request.argument, sizeof(request.argument), "%s", argument);
+
+    EStats snapshot;
+    struct iovec iov[2] = {
+        {.iov_base = response, .iov_len = sizeof(*response)},
+        {.iov_base = stats != NULL ? (void *) stats : (void *) &snapshot, .iov_len = sizeof(EStats)}
+    };
+    struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2};
+    memset(response, 0, sizeof(*response));
+    if (send(fd, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)
+        || recvmsg(fd, &msg, 0) < (ssize_t) sizeof(*response) || response->magic != CONTROL_MAGIC) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    /* The client keeps the connection until it has exited, so the device is free again afterwards. */
+    if (command == CONTROL_STOP && !response->status) {
+        char c;
+        while (recv(fd, &c, sizeof(c), 0) > 0);
+    }
+
+    close(fd);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Pauses the devices of the running input client that read the input `event`.
+ * Returns the mask of the devices that were paused.
+ */
+static uint32_t pause_event(int event)
+{
+    EControlResponse response;
+    if (LControlSend(CONTROL_STATUS, NULL, CONTROL_ALL_DEVICES, &response, NULL))
+        return 0;
+
+    /* Devices paused by someone else are left paused afterwards. */
+    uint32_t devices = 0;
+    int count = response.devices < 32 ? response.devices : 32;
+    for (int i = 0; i < count; i++) {
+        if (LControlSend(CONTROL_STATUS, NULL, i, &response, NULL) || response.event != event || response.paused)
+            continue;
+        if (!LControlSend(CONTROL_PAUSE, NULL, i, &response, NULL) && !response.status)
+            devices |= 1u << i;
+    }
+    return devices;
+}
+
+/*
+ * Pauses the devices of the running input client that read the input `event` opened as `fd`,
+ * so they let go of its grab and the events reach the caller. Sets the paused `devices` for `LControlResumeEvent`.
+ * Fails if the input is still grabbed, by another program or by a client that couldn't be reached.
+ */
+int LControlTakeEvent(int event, int fd, uint32_t *devices)
+{
+    /* A pause is answered once the device is released, so the grab is free right after it. */
+    *devices = pause_event(event);
+    if (!LIsEventGrabbed(fd))
+        return EXIT_SUCCESS;
+
+    ERRLN("The touchpad is grabbed exclusively by another program.");
+    LOGLN("Its events wouldn't reach abstouch-nux, stop that program first.");
+    LControlResumeEvent(*devices);
+    *devices = 0;
+    return EXIT_FAILURE;
+}
+
+/*
+ * Resumes the `devices` of the running input client that `LControlTakeEvent` paused.
+ */
+void LControlResumeEvent(uint32_t devices)
+{
+    EControlResponse response;
+    for (int i = 0; devices; i++, devices >>= 1) {
+        if (devices & 1)
+            LControlSend(CONTROL_RESUME, NULL, i, &response, NULL);
+    }
+}
@@ -0,0 +1,120 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_CONTROL_H
+#define _LINUX_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "stats.h"
+
+#define CONTROL_SOCKET "abstouch-nux.sock"
+#define CONTROL_MAGIC 0x41544354
+#define CONTROL_VERSION 2
+
+/*
+ * Time in milliseconds to wait for the input client to answer or to exit.
+ */
+#define CONTROL_TIMEOUT 2000
+
+/*
+ * Requests the input client can be sent.
+ * - CONTROL_STOP = Stops the client, answered once it has exited.
+ * - CONTROL_RELOAD = Reloads the configuration.
+ * - CONTROL_STATUS = Answers with the state of the client.
+ * - CONTROL_STATS = Answers with a snapshot of the statistics as well.
+ * - CONTROL_PAUSE = Stops mapping and gives the touchpad back.
+ * - CONTROL_RESUME = Takes the touchpad and maps it again.
+ * - CONTROL_PROFILE = Switches to the configuration named in the argument.
+ */
+#define CONTROL_STOP 0
+#define CONTROL_RELOAD 1
+#define CONTROL_STATUS 2
+#define CONTROL_STATS 3
+#define CONTROL_PAUSE 4
+#define CONTROL_RESUME 5
+#define CONTROL_PROFILE 6
+
+/*
+ * Device index of the requests that are for every device.
+ */
+#define CONTROL_ALL_DEVICES -1
+
+/*
+ * A request to the input client for the device at index `device`.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t command;
+    int32_t device;
+    char argument[256];
+} EControlRequest;
+
+/*
+ * The answer of the input client, followed by an `EStats` snapshot if `has_stats` is true.
+ */
+typedef struct {
+    uint32_t magic;
+    int32_t status;
+    int32_t pid;
+    int32_t devices;
+    int32_t event;
+    uint8_t paused;
+    uint8_t attached;
+    uint8_t has_stats;
+    uint8_t reserved;
+    char profile[256];
+} EControlResponse;
+
+/*
+ * Writes the path of the control socket to `path`.
+ */
+int LControlPath(char *path, size_t size);
+
+/*
+ * Returns a new non-blocking fd listening on the control socket, or -1.
+ * A socket left behind by a client that has exited is replaced.
+ */
+int LControlListen(void);
+
+/*
+ * Removes the control socket listening on `fd`.
+ */
+void LControlClose(int fd);
+
+/*
+ * Sends the `command` with `argument` for the device at index `device` to the running input client
+ * and waits for its `response`. `stats` receives the snapshot of the statistics if it isn't NULL.
+ * Returns EXIT_FAILURE if no input client is running.
+ */
+int LControlSend(int command, char *argument, int device, EControlResponse *response, EStats *stats);
+
+/*
+ * Pauses the devices of the running input client that read the input `event` opened as `fd`,
+ * so they let go of its grab and the events reach the caller. Sets the paused `devices` for `LControlResumeEvent`.
+ * Fails if the input is still grabbed, by another program or by a client that couldn't be reached.
+ */
+int LControlTakeEvent(int event, int fd, uint32_t *devices);
+
+/*
+ * Resumes the `devices` of the running input client that `LControlTakeEvent` paused.
+ */
+void LControlResumeEvent(uint32_t devices);
+
+#endif /* _LINUX_CONTROL_H */
@@ -0,0 +1,141 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "correction.h"
+#include "../config.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Writes the path of the correction table of `profile` to `path`.
+ */
+void LGetCorrectionPath(char *profile, char *path, size_t size)
+{
+    char *dir = CGetConfigDir();
+    snprintf(path, size, "%s/%s.lut", dir, profile != NULL ? profile : "abstouch-nux");
+    free(dir);
+}
+
+/*
+ * Sets up `correction` to use the table with the `header` and the `nodes`, which must outlive it.
+ */
+int LCorrectionInit(ECorrection *correction, const ECorrectionHeader *header, const ECorrectionNode *nodes)
+{
+    if (header->columns < 2 || header->rows < 2 || header->columns > CORRECTION_MAX_NODES || header->rows > CORRECTION_MAX_NODES
+        || header->x_max <= header->x_min || header->y_max <= header->y_min)
+        return EXIT_FAILURE;
+
+    memset(correction, 0, sizeof(*correction));
+    correction->header = header;
+    correction->nodes = nodes;
+    correction->columns = header->columns;
+    correction->rows = header->rows;
+    correction->x_min = header->x_min;
+    correction->y_min = header->y_min;
+
+    /* Cells per device unit, so the lookup needs no division. */
+    correction->scale_x = (((int64_t) header->columns - 1) << (2 * CORRECTION_SHIFT)) / ((int64_t) header->x_max - header->x_min);
+    correction->scale_y = (((int64_t) header->rows - 1) << (2 * CORRECTION_SHIFT)) / ((int64_t) header->y_max - header->y_min);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Maps the correction table at `path` into `correction`.
+ */
+int LOpenCorrection(ECorrection *correction, char *path)
+{
+    memset(correction, 0, sizeof(*correction));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ERRLN("Couldn't open \x1b[;m%s\x1b[1;37m.", path);
+        LOGLN("See: \x1b[;mabstouch calibrate --grid");
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(ECorrectionHeader)) {
+        ERRLN("\x1b[;m%s\x1b[1;37m is not a correction table.", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ERRLN("Couldn't map \x1b[;m%s\x1b[1;37m.", path);
+        return EXIT_FAILURE;
+    }
+
+    const ECorrectionHeader *header = data;
+    if (memcmp(header->magic, CORRECTION_MAGIC, sizeof(header->magic)) || header->version != CORRECTION_VERSION
+        || header->header_size < sizeof(ECorrectionHeader)
+        || header->header_size + (size_t) header->columns * header->rows * sizeof(ECorrectionNode) > (size_t) st.st_size
+        || LCorrectionInit(correction, header, (const ECorrectionNode *) ((const char *) data + header->header_size))) {
+        ERRLN("\x1b[;m%s\x1b[1;37m is not a supported correction table.", path);
+        munmap(data, st.st_size);
+        return EXIT_FAILURE;
+    }
+
+    correction->size = st.st_size;
+    correction->mapped = 1;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Writes the table with the `header` and the `nodes` to `path`.
+ */
+int LWriteCorrection(char *path, const ECorrectionHeader *header, const ECorrectionNode *nodes)
+{
+    /* A running client may have the old table mapped, so the new one replaces it instead of overwriting it. */
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *f = fopen(temp, "wb");
+    if (f == NULL) {
+        ERRLN("Couldn't open \x1b[;m%s\x1b[1;37m.", temp);
+        return EXIT_FAILURE;
+    }
+
+    size_t count = (size_t) header->columns * header->rows;
+    int failed = fwrite(header, sizeof(*header), 1, f) != 1 || fwrite(nodes, sizeof(*nodes), count, f) != count;
+    failed |= fclose(f) != 0;
+    if (failed || rename(temp, path)) {
+        ERRLN("Couldn't write \x1b[;m%s\x1b[1;37m.", path);
+        unlink(temp);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Unmaps the table of `correction` if it was mapped.
+ */
+void LCloseCorrection(ECorrection *correction)
+{
+    if (correction->mapped && correction->header != NULL)
+        munmap((void *) correction->header, correction->size);
+    correction->header = NULL;
+    correction->mapped = 0;
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_CORRECTION_H
+#define _LINUX_CORRECTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CORRECTION_MAGIC "ATLU"
+#define CORRECTION_VERSION 1
+
+/*
+ * Most nodes the table can have on a side, so it always fits in the cache.
+ */
+#define CORRECTION_MAX_NODES 64
+
+/*
+ * Fractional bits of the position inside a cell.
+ */
+#define CORRECTION_SHIFT 16
+
+/*
+ * Header at the start of a correction table.
+ * The `columns` x `rows` nodes are spread evenly from `x_min`, `y_min` to `x_max`, `y_max` in device units.
+ */
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t columns;
+    uint16_t rows;
+    int32_t x_min, x_max;
+    int32_t y_min, y_max;
+    uint32_t reserved;
+} ECorrectionHeader;
+
+/*
+ * Displacement in device units that is added to the positions at a node, row by row after the header.
+ */
+typedef struct {
+    int16_t dx;
+    int16_t dy;
+} ECorrectionNode;
+
+/*
+ * Struct that holds a correction table, usually mapped from its file,
+ * with the fixed-point factors from device units to cells, with twice the fractional bits.
+ */
+typedef struct {
+    const ECorrectionHeader *header;
+    const ECorrectionNode *nodes;
+    size_t size;
+    int mapped;
+
+    int columns, rows;
+    int32_t x_min, y_min;
+    int64_t scale_x, scale_y;
+} ECorrection;
+
+/*
+ * Writes the path of the correction table of `profile` to `path`.
+ */
+void LGetCorrectionPath(char *profile, char *path, size_t size);
+
+/*
+ * Sets up `correction` to use the table with the `header` and the `nodes`, which must outlive it.
+ */
+int LCorrectionInit(ECorrection *correction, const ECorrectionHeader *header, const ECorrectionNode *nodes);
+
+/*
+ * Maps the correction table at `path` into `correction`.
+ */
+int LOpenCorrection(ECorrection *correction, char *path);
+
+/*
+ * Writes the table with the `header` and the `nodes` to `path`.
+ */
+int LWriteCorrection(char *path, const ECorrectionHeader *header, const ECorrectionNode *nodes);
+
+/*
+ * Unmaps the table of `correction` if it was mapped.
+ */
+void LCloseCorrection(ECorrection *correction);
+
+/*
+ * Moves `x`, `y` by the displacement of the table, bilinearly interpolated between the four nodes around it.
+ * Positions off the table get the displacement of its edge.
+ */
+static inline void LCorrect(const ECorrection *correction, int *x, int *y)
+{
+    int64_t fx = ((int64_t) (*x - correction->x_min) * correction->scale_x) >> CORRECTION_SHIFT;
+    int64_t fy = ((int64_t) (*y - correction->y_min) * correction->scale_y) >> CORRECTION_SHIFT;
+    int64_t max_fx = (int64_t) (correction->columns - 1) << CORRECTION_SHIFT;
+    int64_t max_fy = (int64_t) (correction->rows - 1) << CORRECTION_SHIFT;
+    fx = fx < 0 ? 0 : fx > max_fx ? max_fx : fx;
+    fy = fy < 0 ? 0 : fy > max_fy ? max_fy : fy;
+
+    /* The last node is reached as the far end of the cell before it. */
+    int column = fx >> CORRECTION_SHIFT, row = fy >> CORRECTION_SHIFT;
+    column = column < correction->columns - 1 ? column : correction->columns - 2;
+    row = row < correction->rows - 1 ? row : correction->rows - 2;
+    int64_t u = fx - ((int64_t) column << CORRECTION_SHIFT);
+    int64_t v = fy - ((int64_t) row << CORRECTION_SHIFT);
+
+    /* Interpolated along the row first, then between the rows, with all the fractional bits kept until the end. */
+    const ECorrectionNode *n0 = correction->nodes + row * correction->columns + column;
+    const ECorrectionNode *n1 = n0 + correction->columns;
+    int64_t top_x = ((int64_t) n0[0].dx << CORRECTION_SHIFT) + (n0[1].dx - n0[0].dx) * u;
+    int64_t top_y = ((int64_t) n0[0].dy << CORRECTION_SHIFT) + (n0[1].dy - n0[0].dy) * u;
+    int64_t bottom_x = ((int64_t) n1[0].dx << CORRECTION_SHIFT) + (n1[1].dx - n1[0].dx) * u;
+    int64_t bottom_y = ((int64_t) n1[0].dy << CORRECTION_SHIFT) + (n1[1].dy - n1[0].dy) * u;
+    int64_t half = (int64_t) 1 << (2 * CORRECTION_SHIFT - 1);
+    *x += (int) (((top_x << CORRECTION_SHIFT) + (bottom_x - top_x) * v + half) >> (2 * CORRECTION_SHIFT));
+    *y += (int) (((top_y << CORRECTION_SHIFT) + (bottom_y - top_y) * v + half) >> (2 * CORRECTION_SHIFT));
+}
+
+#endif /* _LINUX_CORRECTION_H */
@@ -82,23 +82,26 @@ XDevice *LOpenXDevice(Display *display, char *name)
 {
     XDeviceInfo *info;
     int num_devices;
+    XDevice *device = NULL;
 
     info = XListInputDevices(display, &num_devices);
-    for (int i = 0; i < num_devices; i++) {
+    for (int i = 0; i < num_devices && device == NULL; i++) {
         if (info[i].use >= IsXExtensionDevice) {
             if (!strcmp(info[i].name, name))
-                return XOpenDevice(display, info[i].id);
+                device = XOpenDevice(display, info[i].id);
             else {
                 XID id = info[i].id;
                 char device_id[256];
                 snprintf(device_id, sizeof(device_id), "%lu", id);
                 if (!strcmp(name, device_id))
-                    return XOpenDevice(display, id);
+                    device = XOpenDevice(display, id);
             }
         }
     }
 
-    return NULL;
+    if (info != NULL)
+        XFreeDeviceList(info);
+    return device;
 }
 
 /*
@@ -106,10 +109,17 @@ XDevice *LOpenXDevice(Display *display, char *name)
  */
 int LSetXDeviceEnabled(Display *display, XDevice *device, int enabled)
 {
-    char *value = calloc(1, sizeof(long));
-    value[0] = enabled;
-    XChangeDeviceProperty(display, device, parse_xatom(display, "Device Enabled"), XA_INTEGER, 8, PropModeReplace, value, 1);
-    XSync(display, 0);
+    /* The atom only changes with the display, so it is looked up once by each thread. */
+    static __thread Display *atom_display = NULL;
+    static __thread Atom atom = None;
+    if (atom_display != display) {
+        atom = parse_xatom(display, "Device Enabled");
+        atom_display = display;
+    }
+
+    unsigned char value = enabled;
+    XChangeDeviceProperty(display, device, atom, XA_INTEGER, 8, PropModeReplace, &value, 1);
+    XFlush(display);
     return EXIT_SUCCESS;
 }
 
@@ -124,6 +134,7 @@ int LSetDisplayInteractive(void)
     if (ndev < 1) {
         ERRLN("Couldn't get displays.");
         LOGLN("Try running as root.");
+        CFreeConfig(&config);
         return EXIT_FAILURE;
     }
 
@@ -185,7 +196,7 @@ int LSetDisplayInteractive(void)
         CUP(1);
         LOGCLEAR("Please enter the display name. => \x1b[;m%s", prefix);
     }
-    config.display = display_name;
+    snprintf(config.display, CONFIG_VALUE_SIZE, "%s", display_name);
 
     LOG("Please enter the screen id. => ");
     while (fgets(s, sizeof(s), stdin)) {
@@ -206,6 +217,7 @@ int LSetDisplayInteractive(void)
 
     SUCCESSLN("Successfully set display configuration.");
     CSetConfig(config);
+    CFreeConfig(&config);
     free(displays);
     free(screens);
     return EXIT_SUCCESS;
@@ -17,6 +17,7 @@
 ****************************************************************************/
 #define _GNU_SOURCE
 #include "event.h"
+#include "probe.h"
 #include "../config.h"
 #include "../print.h"
 
@@ -25,6 +26,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/ioctl.h>
 
 #define BITS_PER_LONG (sizeof(long) * 8)
 #define NBITS(x) ((((x)-1)/BITS_PER_LONG)+1)
@@ -102,6 +105,23 @@ const char *const absolutes[ABS_MAX + 1] = {
  */
 const char *const keys[KEY_MAX + 1] = {
     [0 ... KEY_MAX] = NULL,
+    NAME_ELEMENT(KEY_ESC),              NAME_ELEMENT(KEY_ENTER),
+    NAME_ELEMENT(KEY_SPACE),            NAME_ELEMENT(KEY_TAB),
+    NAME_ELEMENT(KEY_LEFTCTRL),         NAME_ELEMENT(KEY_LEFTSHIFT),
+    NAME_ELEMENT(KEY_LEFTALT),          NAME_ELEMENT(KEY_LEFTMETA),
+    NAME_ELEMENT(KEY_A),                NAME_ELEMENT(KEY_B),
+    NAME_ELEMENT(KEY_C),                NAME_ELEMENT(KEY_D),
+    NAME_ELEMENT(KEY_E),                NAME_ELEMENT(KEY_F),
+    NAME_ELEMENT(KEY_G),                NAME_ELEMENT(KEY_H),
+    NAME_ELEMENT(KEY_I),                NAME_ELEMENT(KEY_J),
+    NAME_ELEMENT(KEY_K),                NAME_ELEMENT(KEY_L),
+    NAME_ELEMENT(KEY_M),                NAME_ELEMENT(KEY_N),
+    NAME_ELEMENT(KEY_O),                NAME_ELEMENT(KEY_P),
+    NAME_ELEMENT(KEY_Q),                NAME_ELEMENT(KEY_R),
+    NAME_ELEMENT(KEY_S),                NAME_ELEMENT(KEY_T),
+    NAME_ELEMENT(KEY_U),                NAME_ELEMENT(KEY_V),
+    NAME_ELEMENT(KEY_W),                NAME_ELEMENT(KEY_X),
+    NAME_ELEMENT(KEY_Y),                NAME_ELEMENT(KEY_Z),
     NAME_ELEMENT(BTN_0),                NAME_ELEMENT(BTN_1),
     NAME_ELEMENT(BTN_2),                NAME_ELEMENT(BTN_3),
     NAME_ELEMENT(BTN_4),                NAME_ELEMENT(BTN_5),
@@ -166,6 +186,21 @@ const char *codename(unsigned int type, unsigned int code)
     return (type <= EV_MAX && code <= maxval[type] && names[type] && names[type][code]) ? names[type][code] : "?";
 }
 
+/*
+ * Returns the input code of `type` with the given `name`, or -1 if unknown.
+ */
+int LGetCodeByName(unsigned int type, char *name)
+{
+    if (type > EV_MAX || names[type] == NULL)
+        return -1;
+
+    for (int code = 0; code <= maxval[type]; code++) {
+        if (names[type][code] != NULL && !strcmp(names[type][code], name))
+            return code;
+    }
+    return -1;
+}
+
 /*
  * Returns new fd of the event with given `event` id.
  */
@@ -184,57 +219,99 @@ int LOpenEvent(int event)
  */
 int LIsAbsoluteEvent(int event)
 {
-    unsigned int type;
-    unsigned long bit[EV_MAX][NBITS(KEY_MAX)];
+    int count;
+    EDeviceInfo *devices = LProbeDevices(&count);
+    EDeviceInfo *device = LFindDevice(devices, count, event);
+    int absolute = device != NULL && LIsAbsoluteDevice(device);
+    free(devices);
+    return absolute;
+}
 
-    int fd = LOpenEvent(event);
-    if (fd < 0)
-        return 0;
-    memset(bit, 0, sizeof(bit));
-    ioctl(fd, EVIOCGBIT(0, EV_MAX), bit[0]);
-    close(fd);
-
-    for (type = 0; type < EV_MAX; type++) {
-        if (test_bit(type, bit[0]) && type != EV_REP) {
-            if (type == EV_ABS)
-                return 1;
-        }
+/*
+ * Returns new fd of the event in `config`.
+ * Looks the event up by name and updates `config` if its id has changed.
+ */
+int LOpenConfiguredEvent(EConfig *config)
+{
+    int count;
+    EDeviceInfo *devices = LProbeDevices(&count);
+
+    /* Event ids can be reused by other devices, so the name has to match as well. */
+    EDeviceInfo *device = LFindDevice(devices, count, config->event);
+    if (device == NULL || !LIsAbsoluteDevice(device)
+        || (config->event_name[0] != '\0' && strcmp(device->name, config->event_name)))
+        device = LFindDeviceByName(devices, count, config->event_name);
+    if (device == NULL || !LIsAbsoluteDevice(device)) {
+        free(devices);
+        ERRLN("Event has no absolute input.");
+        return -1;
     }
 
-    return 0;
+    if (device->event != config->event) {
+        config->event = device->event;
+        CSetConfig(*config);
+    }
+    free(devices);
+    return LOpenEvent(config->event);
 }
 
 /*
- * Scans all events and returns the event id with the given name `ename`.
+ * Grabs the event `fd` exclusively if `grab` is true, releases it otherwise.
+ * The kernel releases the grab when the fd is closed.
  */
-int LGetEventByName(char *ename)
+int LGrabEvent(int fd, int grab)
 {
-    struct dirent **namelist;
-    char *filename;
-    int max_device = 0;
-
-    int ndev = scandir(DEV_INPUT_DIR, &namelist, LIsEventDevice, versionsort);
-    if (ndev < 1)
-        return -1;
+    return ioctl(fd, EVIOCGRAB, (void *) (long) grab) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-    for (int i = 0; i < ndev; i++) {
-        char name[256];
+/*
+ * Returns true if another program holds the exclusive grab of the event `fd`.
+ */
+int LIsEventGrabbed(int fd)
+{
+    if (!LGrabEvent(fd, 1)) {
+        LGrabEvent(fd, 0);
+        return 0;
+    }
+    return errno == EBUSY;
+}
 
-        int fd = LOpenEvent(i);
-        if (fd < 0) {
-            if (i + 1 != ndev)
-                ndev++;
-            continue;
-        }
+/*
+ * Reads the identity of the event `fd` into `identity`.
+ */
+int LGetEventIdentity(int fd, EEventIdentity *identity)
+{
+    memset(identity, 0, sizeof(*identity));
+    if (ioctl(fd, EVIOCGNAME(sizeof(identity->name) - 1), identity->name) < 0
+        || ioctl(fd, EVIOCGID, &identity->id) < 0)
+        return EXIT_FAILURE;
 
-        ioctl(fd, EVIOCGNAME(sizeof(name)), name);
-        close(fd);
+    /* Not every device has a physical path, those are matched without it. */
+    ioctl(fd, EVIOCGPHYS(sizeof(identity->phys) - 1), identity->phys);
+    return EXIT_SUCCESS;
+}
 
-        if (!strcmp(ename, name))
-            return i;
-    }
+/*
+ * Returns true if the identities `a` and `b` are of the same device.
+ */
+int LIsSameEvent(EEventIdentity *a, EEventIdentity *b)
+{
+    return a->id.bustype == b->id.bustype && a->id.vendor == b->id.vendor
+        && a->id.product == b->id.product && !strcmp(a->name, b->name)
+        && !strcmp(a->phys, b->phys);
+}
 
-    return -1;
+/*
+ * Scans all events and returns the event id with the given name `ename`.
+ */
+int LGetEventByName(char *ename)
+{
+    int count;
+    EDeviceInfo *devices = LProbeDevices(&count);
+    EDeviceInfo *device = LFindDeviceByName(devices, count, ename);
+    int event = device != NULL ? device->event : -1;
+    free(devices);
+    return event;
 }
 
 /*
@@ -242,13 +319,13 @@ int LGetEventByName(char *ename)
  */
 char *LGetEventName(int event)
 {
-    int fd = LOpenEvent(event);
-    char *name = malloc(256);
-    if (fd < 0)
-        return name;
-    
-    ioctl(fd, EVIOCGNAME(256), name);
-    close(fd);
+    int count;
+    EDeviceInfo *devices = LProbeDevices(&count);
+    EDeviceInfo *device = LFindDevice(devices, count, event);
+    char *name = calloc(1, 256);
+    if (device != NULL)
+        strcpy(name, device->name);
+    free(devices);
     return name;
 }
 
@@ -258,43 +335,25 @@ char *LGetEventName(int event)
 int LSetEventInteractive(void)
 {
     EConfig config = CGetConfig();
-    struct dirent **namelist;
-    int ndev, max = 0;
-
-    ndev = scandir(DEV_INPUT_DIR, &namelist, LIsEventDevice, versionsort);
-    if (ndev < 1) {
+    int count, max = 0;
+    EDeviceInfo *devices = LProbeDevices(&count);
+    if (devices == NULL || count < 1) {
+        free(devices);
         ERRLN("Couldn't get events.");
         LOGLN("Try running as root.");
+        CFreeConfig(&config);
         return EXIT_FAILURE;
     }
 
-    size_t ids_len = 0;
-    int *ids = malloc(ids_len);
     LOGLN("Events:");
-    for (int i = 0; i < ndev; i++) {
-        char fname[256];
-        char name[256] = "\x1b[1;31mUnknown\x1b[;m";
-        
-        int fd = -1;
-        snprintf(fname, sizeof(fname), "%s/%s", DEV_INPUT_DIR, namelist[i]->d_name);
-        fd = open(fname, O_RDONLY);
-        if (fd < 0)
-            continue;
-
-        int id = 0;
-        sscanf(namelist[i]->d_name, "event%d", &id);
-        ids = realloc(ids, ++ids_len * sizeof(int));
-        ids[ids_len - 1] = id;
-        if (max < id)
-            max = id;
-
-        ioctl(fd, EVIOCGNAME(sizeof(name)), name);
-
-        PRINTLN("   - \x1b[0;37m%d => \x1b[0;37m%s", id, name);
-        close(fd);
+    for (int i = 0; i < count; i++) {
+        if (max < devices[i].event)
+            max = devices[i].event;
+        PRINTLN("   - \x1b[0;37m%d => \x1b[0;37m%s", devices[i].event, devices[i].name[0] ? devices[i].name : "\x1b[1;31mUnknown\x1b[;m");
     }
 
     int event;
+    EDeviceInfo *device = NULL;
     char *p, s[64];
     LOG("Please enter the event id. => [\x1b[0;37m0-\x1b[0;37m%d] => ", max);
     while (fgets(s, sizeof(s), stdin)) {
@@ -305,33 +364,32 @@ int LSetEventInteractive(void)
             continue;
         }
         
-        if (LIsAbsoluteEvent(event))
+        device = LFindDevice(devices, count, event);
+        if (device != NULL && LIsAbsoluteDevice(device))
             break;
 
+        device = NULL;
         CUP(1);
         ERRCLEAR("No absolute input found. Please enter the event id. => [\x1b[0;37m0-\x1b[0;37m%d] => ", max);
     }
+    if (device == NULL) {
+        free(devices);
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
 
     config.event = event;
-    char name[256] = "?";
-    int abs_x[6] = {0}, abs_y[6] = {0};
-    int fd = LOpenEvent(event);
-    ioctl(fd, EVIOCGNAME(sizeof(name)), name);
-    ioctl(fd, EVIOCGABS(ABS_X), abs_x);
-    ioctl(fd, EVIOCGABS(ABS_Y), abs_y);
-    int x_min = abs_x[1], x_max = abs_x[2];
-    int y_min = abs_y[1], y_max = abs_y[2];
-    strcpy((config.event_name = malloc(256)), name);
-    close(fd);
+    snprintf(config.event_name, CONFIG_VALUE_SIZE, "%s", device->name);
     SUCCESSLN("Successfully set input event.");
 
-    config.x_min = x_min;
-    config.x_max = x_max;
-    config.y_min = y_min;
-    config.y_max = y_max;
+    config.x_min = device->absinfo[ABS_X].minimum;
+    config.x_max = device->absinfo[ABS_X].maximum;
+    config.y_min = device->absinfo[ABS_Y].minimum;
+    config.y_max = device->absinfo[ABS_Y].maximum;
 
     SUCCESSLN("Successfully set the limits.");
     CSetConfig(config);
-    free(ids);
+    free(devices);
+    CFreeConfig(&config);
     return EXIT_SUCCESS;
 }
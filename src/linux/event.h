@@ -21,14 +21,31 @@
 #include <dirent.h>
 #include <linux/input.h>
 
+#include "../config.h"
+
 #define DEV_INPUT_DIR "/dev/input"
 #define EVENT_PREFIX "event"
 
+/*
+ * Struct that holds the identity of an input event that is stable across reconnects,
+ * unlike its event id.
+ */
+typedef struct {
+    char name[256];
+    char phys[256];
+    struct input_id id;
+} EEventIdentity;
+
 /*
  * Returns true if dirent starts with event prefix.
  */
 int LIsEventDevice(const struct dirent *dir); 
 
+/*
+ * Returns the input code of `type` with the given `name`, or -1 if unknown.
+ */
+int LGetCodeByName(unsigned int type, char *name);
+
 /*
  * Returns new fd of the event with given `event` id.
  */
@@ -39,6 +56,33 @@ int LOpenEvent(int event);
  */
 int LIsAbsoluteEvent(int event);
 
+/*
+ * Returns new fd of the event in `config`.
+ * Looks the event up by name and updates `config` if its id has changed.
+ */
+int LOpenConfiguredEvent(EConfig *config);
+
+/*
+ * Grabs the event `fd` exclusively if `grab` is true, releases it otherwise.
+ * The kernel releases the grab when the fd is closed.
+ */
+int LGrabEvent(int fd, int grab);
+
+/*
+ * Returns true if another program holds the exclusive grab of the event `fd`.
+ */
+int LIsEventGrabbed(int fd);
+
+/*
+ * Reads the identity of the event `fd` into `identity`.
+ */
+int LGetEventIdentity(int fd, EEventIdentity *identity);
+
+/*
+ * Returns true if the identities `a` and `b` are of the same device.
+ */
+int LIsSameEvent(EEventIdentity *a, EEventIdentity *b);
+
 /*
  * Scans all events and returns the event id with the given name `ename`.
  */
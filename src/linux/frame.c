@@ -0,0 +1,254 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "frame.h"
+#include "probe.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+/*
+ * Tool keys of one to five fingers, in the order the kernel sends them.
+ */
+static const int tools[] = {BTN_TOOL_FINGER, BTN_TOOL_DOUBLETAP, BTN_TOOL_TRIPLETAP, BTN_TOOL_QUADTAP, BTN_TOOL_QUINTTAP};
+#define TOOL_COUNT ((int) (sizeof(tools) / sizeof(tools[0])))
+
+/*
+ * Takes the position of the primary contact into the pending state of the `assembler`,
+ * leaving out the contacts the palm classifier rejects. Single touch devices always have their one contact.
+ */
+static void update_contacts(EFrameAssembler *assembler)
+{
+    EFrame *pending = &assembler->pending;
+    double time = pending->time.tv_sec + pending->time.tv_usec / 1e6;
+    ESlots *slots = &assembler->slots;
+    if (!slots->multitouch) {
+        pending->contacts = pending->touch;
+        pending->rejected = pending->touch
+            && LPalmClassify(&assembler->palm, pending->contact, pending->fingers, pending->width, pending->pressure, time);
+        return;
+    }
+
+    slots->rejected = LPalmClassifySlots(&assembler->palm, slots, time);
+    int primary = LSlotsCommit(slots);
+    pending->contacts = __builtin_popcount(slots->active);
+    pending->slot = primary;
+    pending->rejected = primary < 0 && slots->active;
+    if (primary < 0)
+        return;
+
+    /* The position stays where the last contact was lifted. */
+    ESlot *slot = &slots->slots[primary];
+    pending->x = slot->x;
+    pending->y = slot->y;
+    pending->contact = slot->sequence;
+    if (slots->pressure)
+        pending->pressure = slot->pressure;
+}
+
+/*
+ * Resyncs the touch and tool keys of the pending state of the `assembler` from the device using `EVIOCGKEY`.
+ * Devices without `BTN_TOUCH` are always touching.
+ */
+static void resync_keys(EFrameAssembler *assembler)
+{
+    unsigned long key_bits[PROBE_LONGS(KEY_CNT)] = {0};
+    unsigned long keys[PROBE_LONGS(KEY_CNT)] = {0};
+    if (assembler->fd < 0 || ioctl(assembler->fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) < 0
+        || ioctl(assembler->fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+        return;
+
+    /* A touch that started while the events were dropped is a new contact, like in `push_key`. */
+    EFrame *pending = &assembler->pending;
+    int touch = PROBE_TEST_BIT(BTN_TOUCH, key_bits) ? (int) PROBE_TEST_BIT(BTN_TOUCH, keys) : 1;
+    if (touch && !pending->touch && !assembler->slots.multitouch)
+        pending->contact++;
+    pending->touch = touch;
+
+    pending->fingers = 0;
+    for (int i = 0; i < TOOL_COUNT; i++) {
+        if (PROBE_TEST_BIT(tools[i], keys))
+            pending->fingers = i + 1;
+    }
+}
+
+/*
+ * Initializes the `assembler` with the current absolute state of `fd`.
+ * `fd` can be negative if there is no device to resync from.
+ */
+void LFrameInit(EFrameAssembler *assembler, int fd)
+{
+    EAxes axes;
+    LReadAxes(fd, &axes);
+    LFrameInitAxes(assembler, fd, &axes);
+}
+
+/*
+ * Initializes the `assembler` with the absolute state in `axes`, resyncing it from `fd` later.
+ * `fd` can be negative if there is no device to resync from, like when replaying a recording.
+ */
+void LFrameInitAxes(EFrameAssembler *assembler, int fd, const EAxes *axes)
+{
+    memset(assembler, 0, sizeof(*assembler));
+    assembler->fd = fd;
+    assembler->pending.x = axes->absinfo[ABS_X].value;
+    assembler->pending.y = axes->absinfo[ABS_Y].value;
+    assembler->pending.pressure = axes->absinfo[ABS_PRESSURE].value;
+    LSlotsInit(&assembler->slots, fd, axes);
+    LPalmInit(&assembler->palm, axes);
+    resync_keys(assembler);
+    update_contacts(assembler);
+    assembler->frame = assembler->pending;
+}
+
+/*
+ * Sets the primary contact policy and the palm classifier of the `assembler` from `config`.
+ */
+int LFrameConfigure(EFrameAssembler *assembler, EConfig *config)
+{
+    int policy = LGetSlotPolicy(config->contact);
+    if (policy < 0)
+        return EXIT_FAILURE;
+
+    assembler->slots.policy = policy;
+    LPalmConfigure(&assembler->palm, config);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Resyncs the pending state of the `assembler` from the device using `EVIOCGABS`, `EVIOCGMTSLOTS` and `EVIOCGKEY`.
+ */
+int LFrameResync(EFrameAssembler *assembler)
+{
+    if (assembler->fd < 0)
+        return -1;
+
+    LSlotsResync(&assembler->slots);
+    resync_keys(assembler);
+
+    struct input_absinfo absinfo;
+    if (!ioctl(assembler->fd, EVIOCGABS(ABS_X), &absinfo))
+        assembler->pending.x = absinfo.value;
+    if (!ioctl(assembler->fd, EVIOCGABS(ABS_Y), &absinfo))
+        assembler->pending.y = absinfo.value;
+    if (!ioctl(assembler->fd, EVIOCGABS(ABS_PRESSURE), &absinfo))
+        assembler->pending.pressure = absinfo.value;
+    return 0;
+}
+
+/*
+ * Pushes the touch and tool key `ev` to the `assembler`.
+ */
+static void push_key(EFrameAssembler *assembler, const struct input_event *ev)
+{
+    EFrame *pending = &assembler->pending;
+    switch (ev->code) {
+        case BTN_TOUCH:
+            /* Single touch devices only tell a new contact by the touch starting again. */
+            if (ev->value && !pending->touch && !assembler->slots.multitouch)
+                pending->contact++;
+            pending->touch = ev->value != 0;
+            return;
+    }
+
+    /*
+     * The kernel sends the tools in code order, so going from two fingers to one presses
+     * BTN_TOOL_FINGER before it releases BTN_TOOL_DOUBLETAP. A release only clears its own count.
+     */
+    for (int i = 0; i < TOOL_COUNT; i++) {
+        if (ev->code != tools[i])
+            continue;
+        if (ev->value)
+            pending->fingers = i + 1;
+        else if (pending->fingers == i + 1)
+            pending->fingers = 0;
+        return;
+    }
+}
+
+/*
+ * Pushes the `ev` to the `assembler`.
+ * Returns true if the event completed a frame.
+ */
+int LFramePush(EFrameAssembler *assembler, const struct input_event *ev)
+{
+    if (ev->type == EV_SYN) {
+        if (ev->code == SYN_DROPPED) {
+            /* Everything up to the next SYN_REPORT is incomplete. */
+            assembler->dropped = 1;
+            return 0;
+        }
+
+        if (ev->code != SYN_REPORT)
+            return 0;
+
+        if (assembler->dropped) {
+            assembler->dropped = 0;
+            LFrameResync(assembler);
+        }
+
+        assembler->pending.time = ev->time;
+        update_contacts(assembler);
+        assembler->frame = assembler->pending;
+        return 1;
+    }
+
+    if (assembler->dropped)
+        return 0;
+
+    if (ev->type == EV_KEY) {
+        push_key(assembler, ev);
+        return 0;
+    }
+
+    if (ev->type != EV_ABS || LSlotsPush(&assembler->slots, ev))
+        return 0;
+
+    /* The single touch emulation jumps between the contacts, the slots are followed instead. */
+    if (assembler->slots.multitouch && ev->code != ABS_PRESSURE && ev->code != ABS_TOOL_WIDTH)
+        return 0;
+
+    switch (ev->code) {
+        case ABS_X:
+            assembler->pending.x = ev->value;
+            break;
+        case ABS_Y:
+            assembler->pending.y = ev->value;
+            break;
+        case ABS_PRESSURE:
+            assembler->pending.pressure = ev->value;
+            break;
+        case ABS_TOOL_WIDTH:
+            assembler->pending.width = ev->value;
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Pushes `count` events from `ev` to the `assembler`.
+ * Returns the count of frames completed, the latest one is in `assembler->frame`.
+ */
+int LFrameFeed(EFrameAssembler *assembler, const struct input_event *ev, int count)
+{
+    int frames = 0;
+    for (int i = 0; i < count; i++)
+        frames += LFramePush(assembler, &ev[i]);
+    return frames;
+}
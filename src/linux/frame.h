@@ -0,0 +1,106 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_FRAME_H
+#define _LINUX_FRAME_H
+
+#include "slots.h"
+#include "palm.h"
+#include "../config.h"
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/*
+ * Struct that holds the absolute state of one complete input frame.
+ * On multitouch devices the position is the one of the primary contact in `slot`,
+ * and `contact` changes whenever another contact becomes the primary one.
+ * `rejected` is set if the frame only has contacts that must not reach the output.
+ */
+typedef struct {
+    int x;
+    int y;
+    int pressure;
+    struct timeval time;
+
+    int contacts;
+    int slot;
+    uint64_t contact;
+
+    /* Single touch state, the count of fingers is from the BTN_TOOL_* keys. */
+    int touch;
+    int fingers;
+    int width;
+
+    int rejected;
+} EFrame;
+
+/*
+ * Struct that collects evdev events until SYN_REPORT and
+ * assembles them into complete frames.
+ */
+typedef struct {
+    int fd;
+
+    /* State collected since the last SYN_REPORT. */
+    EFrame pending;
+    /* Latest complete frame. */
+    EFrame frame;
+
+    /* Multitouch slots of the device and the classifier of its contacts. */
+    ESlots slots;
+    EPalm palm;
+
+    /* Set after SYN_DROPPED until the next SYN_REPORT. */
+    int dropped;
+} EFrameAssembler;
+
+/*
+ * Initializes the `assembler` with the current absolute state of `fd`.
+ * `fd` can be negative if there is no device to resync from.
+ */
+void LFrameInit(EFrameAssembler *assembler, int fd);
+
+/*
+ * Initializes the `assembler` with the absolute state in `axes`, resyncing it from `fd` later.
+ * `fd` can be negative if there is no device to resync from, like when replaying a recording.
+ */
+void LFrameInitAxes(EFrameAssembler *assembler, int fd, const EAxes *axes);
+
+/*
+ * Sets the primary contact policy and the palm classifier of the `assembler` from `config`.
+ */
+int LFrameConfigure(EFrameAssembler *assembler, EConfig *config);
+
+/*
+ * Resyncs the pending state of the `assembler` from the device using `EVIOCGABS`, `EVIOCGMTSLOTS` and `EVIOCGKEY`.
+ */
+int LFrameResync(EFrameAssembler *assembler);
+
+/*
+ * Pushes the `ev` to the `assembler`.
+ * Returns true if the event completed a frame.
+ */
+int LFramePush(EFrameAssembler *assembler, const struct input_event *ev);
+
+/*
+ * Pushes `count` events from `ev` to the `assembler`.
+ * Returns the count of frames completed, the latest one is in `assembler->frame`.
+ */
+int LFrameFeed(EFrameAssembler *assembler, const struct input_event *ev, int count);
+
+#endif /* _LINUX_FRAME_H */
@@ -0,0 +1,124 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#define _GNU_SOURCE
+#include "hotplug.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/inotify.h>
+
+/*
+ * Opens the input event `name` and returns its fd if it is the device of `hotplug`, -1 otherwise.
+ */
+static int open_matching(EHotplug *hotplug, const char *name)
+{
+    if (strncmp(name, EVENT_PREFIX, strlen(EVENT_PREFIX)))
+        return -1;
+
+    char path[64 + NAME_MAX];
+    snprintf(path, sizeof(path), "%s/%s", DEV_INPUT_DIR, name);
+    int fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    EEventIdentity identity;
+    if (LGetEventIdentity(fd, &identity) || !LIsSameEvent(&identity, &hotplug->identity)) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * Starts watching the input events for the device of the event `fd`.
+ */
+int LHotplugInit(EHotplug *hotplug, int fd)
+{
+    hotplug->fd = -1;
+    if (LGetEventIdentity(fd, &hotplug->identity))
+        return EXIT_FAILURE;
+
+    /* Nodes are created before udev gives them their permissions, so both are watched. */
+    hotplug->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (hotplug->fd < 0)
+        return EXIT_FAILURE;
+    if (inotify_add_watch(hotplug->fd, DEV_INPUT_DIR, IN_CREATE | IN_ATTRIB) < 0) {
+        close(hotplug->fd);
+        hotplug->fd = -1;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Scans the input events for the device and returns a new non-blocking fd of it,
+ * or -1 if it isn't there.
+ */
+int LHotplugScan(EHotplug *hotplug)
+{
+    struct dirent **namelist;
+    int ndev = scandir(DEV_INPUT_DIR, &namelist, LIsEventDevice, versionsort);
+    if (ndev < 0)
+        return -1;
+
+    int fd = -1;
+    for (int i = 0; i < ndev; i++) {
+        if (fd < 0)
+            fd = open_matching(hotplug, namelist[i]->d_name);
+        free(namelist[i]);
+    }
+    free(namelist);
+    return fd;
+}
+
+/*
+ * Drains the pending notifications of the watch. If `find` is true,
+ * returns a new non-blocking fd of the device if it has appeared, or -1 otherwise.
+ */
+int LHotplugRead(EHotplug *hotplug, int find)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int fd = -1;
+    for (;;) {
+        ssize_t len = read(hotplug->fd, buf, sizeof(buf));
+        if (len <= 0)
+            return fd;
+
+        for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *) p)->len) {
+            struct inotify_event *event = (struct inotify_event *) p;
+            if (find && fd < 0 && event->len)
+                fd = open_matching(hotplug, event->name);
+        }
+    }
+}
+
+/*
+ * Stops watching the input events.
+ */
+void LHotplugClose(EHotplug *hotplug)
+{
+    if (hotplug->fd >= 0)
+        close(hotplug->fd);
+    hotplug->fd = -1;
+}
@@ -0,0 +1,53 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_HOTPLUG_H
+#define _LINUX_HOTPLUG_H
+
+#include "event.h"
+
+/*
+ * Struct that watches the input events for the device with `identity` to come back.
+ */
+typedef struct {
+    int fd;
+    EEventIdentity identity;
+} EHotplug;
+
+/*
+ * Starts watching the input events for the device of the event `fd`.
+ */
+int LHotplugInit(EHotplug *hotplug, int fd);
+
+/*
+ * Scans the input events for the device and returns a new non-blocking fd of it,
+ * or -1 if it isn't there.
+ */
+int LHotplugScan(EHotplug *hotplug);
+
+/*
+ * Drains the pending notifications of the watch. If `find` is true,
+ * returns a new non-blocking fd of the device if it has appeared, or -1 otherwise.
+ */
+int LHotplugRead(EHotplug *hotplug, int find);
+
+/*
+ * Stops watching the input events.
+ */
+void LHotplugClose(EHotplug *hotplug);
+
+#endif /* _LINUX_HOTPLUG_H */
@@ -0,0 +1,197 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#define _GNU_SOURCE
+#include "log.h"
+#include "../print.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+/*
+ * Prints the message of the `record` on the lines of its ring, starting with `prefix`.
+ */
+static void print_message(ELogRecord *record, const char *prefix)
+{
+    LCLEAR();
+    switch (record->type) {
+        case LOG_RELOADED:
+            SUCCESSLN("%sReloaded the configuration.", prefix);
+            break;
+        case LOG_LOST:
+            LOGLN("%sLost the device, waiting for it...", prefix);
+            break;
+        case LOG_BACK:
+            SUCCESSLN("%sThe device is back.", prefix);
+            break;
+    }
+    LCLEAR();
+    printf("\n");
+}
+
+/*
+ * Prints the `input` record and the count of records that were `dropped` on the lines of its ring,
+ * starting with `prefix`.
+ */
+static void print_input(ELogRecord *input, uint64_t dropped, const char *prefix)
+{
+    LCLEAR();
+    SUCCESSLN("%sGot input at \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d \x1b[1;37mwith \x1b[0;37m%d \x1b[1;37mpressure.", prefix, input->x, input->y, input->pressure);
+    LCLEAR();
+    if (dropped) {
+        SUCCESSLN("%sMoved cursor to \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m, dropped \x1b[0;37m%lu\x1b[1;37m records.", prefix, input->cx, input->cy, (unsigned long) dropped);
+    } else
+        SUCCESSLN("%sMoved cursor to \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m.", prefix, input->cx, input->cy);
+}
+
+/*
+ * Prints everything written to the ring at `index` of the `printer` since the last call, on its own lines.
+ * Messages are printed in order, of the inputs only the latest one.
+ */
+static void drain(ELogPrinter *printer, int index)
+{
+    ELog *log = printer->logs[index];
+    ELogRecord input;
+    int has_input = 0;
+    int printed = 0;
+
+    /* The rings are one under the other, the cursor stays below the last one. */
+    int above = (printer->count - index) * LOG_LINES;
+    char prefix[sizeof(log->name) + 2] = "";
+    if (printer->count > 1)
+        snprintf(prefix, sizeof(prefix), "%s: ", log->name);
+
+    uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&log->head, memory_order_acquire);
+    for (; tail != head; tail++) {
+        ELogRecord *record = &log->records[tail & (LOG_RING_SIZE - 1)];
+        if (record->type == LOG_INPUT) {
+            input = *record;
+            has_input = 1;
+            continue;
+        }
+
+        CUP(above);
+        print_message(record, prefix);
+        CDOWN(above - LOG_LINES);
+        printed = 1;
+    }
+    atomic_store_explicit(&log->tail, tail, memory_order_release);
+
+    if (has_input) {
+        CUP(above);
+        print_input(&input, atomic_load_explicit(&log->dropped, memory_order_relaxed), prefix);
+        CDOWN(above - LOG_LINES);
+        printed = 1;
+    }
+    if (printed)
+        fflush(stdout);
+}
+
+/*
+ * Prints the rings of the `printer` in `data` at LOG_RATE_HZ until it is stopped.
+ */
+static void *printer_thread(void *data)
+{
+    ELogPrinter *printer = data;
+
+    /* The terminal must never take the CPU from the input loop. */
+    struct sched_param param = {.sched_priority = 0};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (atomic_load(&printer->running)) {
+        next.tv_nsec += 1000000000L / LOG_RATE_HZ;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (!atomic_load(&printer->shown))
+            continue;
+        for (int i = 0; i < printer->count; i++)
+            drain(printer, i);
+    }
+
+    if (!atomic_load(&printer->shown))
+        return NULL;
+    for (int i = 0; i < printer->count; i++)
+        drain(printer, i);
+    return NULL;
+}
+
+/*
+ * Initializes the empty ring of the `log` of the device called `name`.
+ */
+void LLogInit(ELog *log, const char *name)
+{
+    atomic_store(&log->head, 0);
+    atomic_store(&log->tail, 0);
+    atomic_store(&log->dropped, 0);
+    snprintf(log->name, sizeof(log->name), "%s", name);
+}
+
+/*
+ * Starts the thread of the `printer` for the `count` rings in `logs`, which prints nothing until `LLogShow`.
+ */
+int LLogStart(ELogPrinter *printer, ELog **logs, int count)
+{
+    if (count > LOG_MAX_RINGS)
+        count = LOG_MAX_RINGS;
+    printer->count = count;
+    memcpy(printer->logs, logs, count * sizeof(ELog *));
+
+    atomic_store(&printer->shown, 0);
+    atomic_store(&printer->running, 1);
+    if (pthread_create(&printer->thread, NULL, printer_thread, printer)) {
+        atomic_store(&printer->running, 0);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Lets the started `printer` print its rings from now on.
+ * The lines of the first ring are the two above the cursor, the others get new lines below them.
+ */
+void LLogShow(ELogPrinter *printer)
+{
+    if (!atomic_load(&printer->running))
+        return;
+
+    for (int i = 1; i < printer->count; i++) {
+        for (int j = 0; j < LOG_LINES; j++)
+            printf("\n");
+    }
+    fflush(stdout);
+    atomic_store(&printer->shown, 1);
+}
+
+/*
+ * Stops the thread of the `printer` after it has printed what is left.
+ */
+void LLogStop(ELogPrinter *printer)
+{
+    if (!atomic_exchange(&printer->running, 0))
+        return;
+
+    pthread_join(printer->thread, NULL);
+}
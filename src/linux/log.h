@@ -0,0 +1,131 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_LOG_H
+#define _LINUX_LOG_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * Count of records the ring holds, a power of two.
+ */
+#define LOG_RING_SIZE 1024
+
+/*
+ * Times per second the printer thread updates the terminal.
+ */
+#define LOG_RATE_HZ 30
+
+/*
+ * Maximum count of rings a printer drains, and the lines each of them takes on the terminal.
+ */
+#define LOG_MAX_RINGS 8
+#define LOG_LINES 2
+
+/*
+ * Record types.
+ * - LOG_INPUT = A frame was mapped, only the latest one is printed on each update.
+ * - LOG_RELOADED = The configuration was reloaded.
+ * - LOG_LOST = The device was lost.
+ * - LOG_BACK = The device is back.
+ */
+#define LOG_INPUT 0
+#define LOG_RELOADED 1
+#define LOG_LOST 2
+#define LOG_BACK 3
+
+/*
+ * Struct that holds a fixed size record written by the input loop.
+ * `time_ns` is the timestamp of the frame for LOG_INPUT.
+ */
+typedef struct {
+    uint64_t time_ns;
+    int32_t type;
+    int32_t x, y, pressure;
+    int32_t cx, cy;
+} ELogRecord;
+
+/*
+ * Struct that holds a single producer, single consumer ring of records of one device.
+ * The producer and the consumer positions are on their own cache lines.
+ */
+typedef struct {
+    _Alignas(64) _Atomic uint64_t head;
+    _Alignas(64) _Atomic uint64_t tail;
+    _Alignas(64) _Atomic uint64_t dropped;
+    ELogRecord records[LOG_RING_SIZE];
+
+    /* Name the lines of the device start with when there are several. */
+    char name[64];
+} ELog;
+
+/*
+ * Struct that holds the thread that prints the rings of every device, each on its own lines.
+ */
+typedef struct {
+    ELog *logs[LOG_MAX_RINGS];
+    int count;
+
+    pthread_t thread;
+    _Atomic int running;
+    /* True once the lines of the rings are on the terminal, nothing is printed before. */
+    _Atomic int shown;
+} ELogPrinter;
+
+/*
+ * Initializes the empty ring of the `log` of the device called `name`.
+ */
+void LLogInit(ELog *log, const char *name);
+
+/*
+ * Starts the thread of the `printer` for the `count` rings in `logs`, which prints nothing until `LLogShow`.
+ */
+int LLogStart(ELogPrinter *printer, ELog **logs, int count);
+
+/*
+ * Lets the started `printer` print its rings from now on.
+ * The lines of the first ring are the two above the cursor, the others get new lines below them.
+ */
+void LLogShow(ELogPrinter *printer);
+
+/*
+ * Stops the thread of the `printer` after it has printed what is left.
+ */
+void LLogStop(ELogPrinter *printer);
+
+/*
+ * Writes the `record` to the `log` without blocking.
+ * The record is dropped and counted if the ring is full. `log` can be NULL.
+ */
+static inline void LLogPush(ELog *log, const ELogRecord *record)
+{
+    if (log == NULL)
+        return;
+
+    uint64_t head = atomic_load_explicit(&log->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&log->tail, memory_order_acquire) >= LOG_RING_SIZE) {
+        atomic_fetch_add_explicit(&log->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    log->records[head & (LOG_RING_SIZE - 1)] = *record;
+    atomic_store_explicit(&log->head, head + 1, memory_order_release);
+}
+
+#endif /* _LINUX_LOG_H */
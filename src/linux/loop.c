@@ -0,0 +1,233 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "loop.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+/*
+ * Returns a free source slot in the `loop` or NULL if it is full.
+ */
+static ELoopSource *free_source(ELoop *loop)
+{
+    for (int i = 0; i < LOOP_MAX_SOURCES; i++) {
+        if (loop->sources[i].fd < 0)
+            return &loop->sources[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Registers the `fd` with `type` in the `loop`.
+ */
+static int add_source(ELoop *loop, int fd, int type, ELoopCallback callback, void *data)
+{
+    ELoopSource *source = free_source(loop);
+    if (source == NULL)
+        return -1;
+
+    /* The event carries the slot and its generation, a pointer alone can't tell a reused slot apart. */
+    uint32_t generation = source->generation + 1;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = (uint64_t) (source - loop->sources) << 32 | generation;
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        return -1;
+
+    source->generation = generation;
+    source->fd = fd;
+    source->type = type;
+    source->callback = callback;
+    source->data = data;
+    return fd;
+}
+
+/*
+ * Initializes the `loop`.
+ */
+int LLoopInit(ELoop *loop)
+{
+    memset(loop, 0, sizeof(*loop));
+    for (int i = 0; i < LOOP_MAX_SOURCES; i++)
+        loop->sources[i].fd = -1;
+    loop->signal_fd = -1;
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    return loop->epfd < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * Calls `callback` whenever `fd` is readable.
+ */
+int LLoopAdd(ELoop *loop, int fd, ELoopCallback callback, void *data)
+{
+    return add_source(loop, fd, LOOP_FD, callback, data);
+}
+
+/*
+ * Stops watching `fd` and closes it if it is a timer or signal source.
+ */
+int LLoopRemove(ELoop *loop, int fd)
+{
+    for (int i = 0; i < LOOP_MAX_SOURCES; i++) {
+        ELoopSource *source = &loop->sources[i];
+        if (source->fd != fd)
+            continue;
+
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+        if (source->type != LOOP_FD)
+            close(fd);
+        if (source->type == LOOP_SIGNAL) {
+            sigprocmask(SIG_SETMASK, &loop->old_mask, NULL);
+            loop->signal_fd = -1;
+        }
+        source->fd = -1;
+        return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/*
+ * Calls `callback` every `interval_ms` milliseconds.
+ * Returns the timer fd that can be passed to `LLoopRemove`.
+ */
+int LLoopAddTimer(ELoop *loop, int interval_ms, ELoopCallback callback, void *data)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(fd, 0, &spec, NULL) < 0 || add_source(loop, fd, LOOP_TIMER, callback, data) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*
+ * Blocks SIGINT, SIGTERM and SIGHUP and calls `callback` when one is received.
+ */
+int LLoopAddSignals(ELoop *loop, ELoopCallback callback, void *data)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+    if (sigprocmask(SIG_BLOCK, &mask, &loop->old_mask) < 0)
+        return -1;
+
+    int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0 || add_source(loop, fd, LOOP_SIGNAL, callback, data) < 0) {
+        if (fd >= 0)
+            close(fd);
+        sigprocmask(SIG_SETMASK, &loop->old_mask, NULL);
+        return -1;
+    }
+
+    loop->signal_fd = fd;
+    return fd;
+}
+
+/*
+ * Dispatches the ready `source`.
+ */
+static void dispatch(ELoop *loop, ELoopSource *source)
+{
+    switch (source->type) {
+        case LOOP_FD:
+            source->callback(loop, source->fd, source->data);
+            break;
+        case LOOP_TIMER: {
+            uint64_t expirations;
+            if (read(source->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                source->callback(loop, (int) expirations, source->data);
+            break;
+        }
+        case LOOP_SIGNAL: {
+            struct signalfd_siginfo info;
+            while (read(source->fd, &info, sizeof(info)) == sizeof(info))
+                source->callback(loop, (int) info.ssi_signo, source->data);
+            break;
+        }
+    }
+}
+
+/*
+ * Waits and dispatches events until `LLoopStop` is called.
+ */
+int LLoopRun(ELoop *loop)
+{
+    struct epoll_event events[LOOP_MAX_SOURCES];
+
+    loop->running = 1;
+    while (loop->running) {
+        int n = epoll_wait(loop->epfd, events, LOOP_MAX_SOURCES, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return EXIT_FAILURE;
+        }
+
+        for (int i = 0; i < n && loop->running; i++) {
+            ELoopSource *source = &loop->sources[events[i].data.u64 >> 32];
+            /* The source might have been removed by an earlier callback, and its slot taken by another one. */
+            if (source->fd < 0 || source->generation != (uint32_t) events[i].data.u64)
+                continue;
+            dispatch(loop, source);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Stops the `loop` after the current dispatch.
+ */
+void LLoopStop(ELoop *loop)
+{
+    loop->running = 0;
+}
+
+/*
+ * Closes the `loop` with its timer and signal sources and restores the signal mask.
+ */
+void LLoopClose(ELoop *loop)
+{
+    for (int i = 0; i < LOOP_MAX_SOURCES; i++) {
+        if (loop->sources[i].fd >= 0)
+            LLoopRemove(loop, loop->sources[i].fd);
+    }
+
+    if (loop->epfd >= 0)
+        close(loop->epfd);
+    loop->epfd = -1;
+}
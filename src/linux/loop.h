@@ -0,0 +1,116 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_LOOP_H
+#define _LINUX_LOOP_H
+
+#include <signal.h>
+#include <stdint.h>
+
+/*
+ * Maximum count of sources a loop can watch.
+ */
+#define LOOP_MAX_SOURCES 64
+
+/*
+ * Source types.
+ * - LOOP_FD = Readable file descriptor.
+ * - LOOP_TIMER = Periodic timer.
+ * - LOOP_SIGNAL = SIGINT, SIGTERM and SIGHUP.
+ */
+#define LOOP_FD 0
+#define LOOP_TIMER 1
+#define LOOP_SIGNAL 2
+
+typedef struct ELoop ELoop;
+
+/*
+ * Callback of a loop source.
+ * `value` is the fd for LOOP_FD, the expiration count for LOOP_TIMER
+ * and the signal number for LOOP_SIGNAL.
+ */
+typedef void (*ELoopCallback)(ELoop *loop, int value, void *data);
+
+/*
+ * Struct that holds a source watched by the loop.
+ */
+typedef struct {
+    int fd;
+    int type;
+    ELoopCallback callback;
+    void *data;
+
+    /* Bumped whenever the slot is taken, so events of a removed source aren't given to the next one. */
+    uint32_t generation;
+} ELoopSource;
+
+/*
+ * Struct that holds an epoll based event loop.
+ */
+struct ELoop {
+    int epfd;
+    int running;
+
+    ELoopSource sources[LOOP_MAX_SOURCES];
+
+    /* Signal mask to restore when the loop is closed. */
+    sigset_t old_mask;
+    int signal_fd;
+};
+
+/*
+ * Initializes the `loop`.
+ */
+int LLoopInit(ELoop *loop);
+
+/*
+ * Calls `callback` whenever `fd` is readable.
+ */
+int LLoopAdd(ELoop *loop, int fd, ELoopCallback callback, void *data);
+
+/*
+ * Stops watching `fd` and closes it if it is a timer or signal source.
+ */
+int LLoopRemove(ELoop *loop, int fd);
+
+/*
+ * Calls `callback` every `interval_ms` milliseconds.
+ * Returns the timer fd that can be passed to `LLoopRemove`.
+ */
+int LLoopAddTimer(ELoop *loop, int interval_ms, ELoopCallback callback, void *data);
+
+/*
+ * Blocks SIGINT, SIGTERM and SIGHUP and calls `callback` when one is received.
+ */
+int LLoopAddSignals(ELoop *loop, ELoopCallback callback, void *data);
+
+/*
+ * Waits and dispatches events until `LLoopStop` is called.
+ */
+int LLoopRun(ELoop *loop);
+
+/*
+ * Stops the `loop` after the current dispatch.
+ */
+void LLoopStop(ELoop *loop);
+
+/*
+ * Closes the `loop` with its timer and signal sources and restores the signal mask.
+ */
+void LLoopClose(ELoop *loop);
+
+#endif /* _LINUX_LOOP_H */
@@ -0,0 +1,315 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "output.h"
+#include "display.h"
+#include "event.h"
+#include "../transform.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+
+#include <linux/uinput.h>
+#include <X11/extensions/XTest.h>
+
+/*
+ * Returns the output backend type with the given `name` or -1 if unknown.
+ */
+int LGetOutputType(char *name)
+{
+    if (!strcmp(name, "x"))
+        return OUTPUT_X;
+    else if (!strcmp(name, "uinput"))
+        return OUTPUT_UINPUT;
+    else if (!strcmp(name, "null"))
+        return OUTPUT_NULL;
+    return -1;
+}
+
+/*
+ * Sets up the axis `code` of the uinput device on `fd` to cover `size` pixels.
+ * The axis is in 1/256 of a pixel, so the sub-pixel part of the positions is kept.
+ */
+static int uinput_abs_setup(int fd, int code, int size)
+{
+    struct uinput_abs_setup abs_setup;
+    memset(&abs_setup, 0, sizeof(abs_setup));
+    abs_setup.code = code;
+    abs_setup.absinfo.minimum = 0;
+    abs_setup.absinfo.maximum = (size << TRANSFORM_SUBPIXEL_BITS) - 1;
+    return ioctl(fd, UI_ABS_SETUP, &abs_setup);
+}
+
+/*
+ * Creates the virtual absolute pointer on the uinput `output`.
+ */
+static int uinput_open(EOutput *output)
+{
+    output->fd = open(UINPUT_DEV, O_WRONLY | O_NONBLOCK);
+    if (output->fd < 0) {
+        ERRLN("Couldn't open \x1b[0;37m%s\x1b[1;37m.", UINPUT_DEV);
+        LOGLN("Make sure the uinput module is loaded and you have access to it.");
+        return EXIT_FAILURE;
+    }
+
+    ioctl(output->fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(output->fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(output->fd, UI_SET_EVBIT, EV_ABS);
+    /* A button makes the device an absolute pointer instead of a touchscreen. */
+    ioctl(output->fd, UI_SET_KEYBIT, BTN_LEFT);
+    if (output->key > 0)
+        ioctl(output->fd, UI_SET_KEYBIT, output->key);
+    ioctl(output->fd, UI_SET_ABSBIT, ABS_X);
+    ioctl(output->fd, UI_SET_ABSBIT, ABS_Y);
+    ioctl(output->fd, UI_SET_PROPBIT, INPUT_PROP_POINTER);
+
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    strncpy(setup.name, UINPUT_NAME, UINPUT_MAX_NAME_SIZE - 1);
+
+    /* The range can't change without creating the device again, which would lose the held keys. */
+    output->axis_width = output->width;
+    output->axis_height = output->height;
+    if (uinput_abs_setup(output->fd, ABS_X, output->axis_width) < 0
+        || uinput_abs_setup(output->fd, ABS_Y, output->axis_height) < 0
+        || ioctl(output->fd, UI_DEV_SETUP, &setup) < 0
+        || ioctl(output->fd, UI_DEV_CREATE) < 0) {
+        ERRLN("Couldn't create the uinput device.");
+        close(output->fd);
+        output->fd = -1;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns the X button of the Linux button `code`, or 0 if X has none.
+ */
+static unsigned int x_button(int code)
+{
+    switch (code) {
+        case BTN_LEFT:
+            return Button1;
+        case BTN_MIDDLE:
+            return Button2;
+        case BTN_RIGHT:
+            return Button3;
+        case BTN_SIDE:
+            return 8;
+        case BTN_EXTRA:
+            return 9;
+    }
+    return 0;
+}
+
+/*
+ * Opens the output backend with the `type` into `output`, which can press `key` besides BTN_LEFT.
+ * `display` can be NULL for backends that don't need X, `key` 0 if it isn't needed.
+ * The `output` takes the `display` over and closes it with itself.
+ */
+int LOpenOutput(EOutput *output, int type, Display *display, int screen, int key)
+{
+    memset(output, 0, sizeof(*output));
+    output->type = type;
+    output->display = display;
+    output->fd = -1;
+    output->key = key;
+
+    if (display != NULL) {
+        XWindowAttributes window_attributes;
+        output->root_window = XRootWindow(display, screen);
+        XGetWindowAttributes(display, output->root_window, &window_attributes);
+        output->width = window_attributes.width;
+        output->height = window_attributes.height;
+    } else {
+        output->width = UINPUT_DEFAULT_SIZE;
+        output->height = UINPUT_DEFAULT_SIZE;
+    }
+
+    switch (type) {
+        case OUTPUT_X: {
+            if (display == NULL) {
+                ERRLN("The X output needs a display.");
+                return EXIT_FAILURE;
+            }
+
+            int event_base, error_base, major, minor;
+            output->xtest = XTestQueryExtension(display, &event_base, &error_base, &major, &minor);
+            return EXIT_SUCCESS;
+        }
+        case OUTPUT_UINPUT:
+            return uinput_open(output);
+        case OUTPUT_NULL:
+            return EXIT_SUCCESS;
+    }
+
+    ERRLN("Unknown output type.");
+    return EXIT_FAILURE;
+}
+
+/*
+ * Opens the display and the output backend in `config` into `output`.
+ */
+int LOpenConfiguredOutput(EOutput *output, EConfig *config, int verbose)
+{
+    int type = LGetOutputType(config->output);
+    if (type < 0) {
+        ERRLN("Unknown output: \x1b[;m%s", config->output);
+        return EXIT_FAILURE;
+    }
+
+    /* The uinput output works without a display, e.g. on Wayland. */
+    Display *display = XOpenDisplay(config->display);
+    if (display == NULL && type == OUTPUT_X) {
+        ERRLN("Couldn't open display \x1b[0;37m%s\x1b[1;37m.", config->display);
+        return EXIT_FAILURE;
+    }
+
+    if (display != NULL) {
+        SUCCESSLNIF(verbose, "Successfully bound to display \x1b[0;37m%s\x1b[1;36m.\x1b[0;37m%d\x1b[1;37m.", config->display, config->screen);
+        if (type == OUTPUT_X && LIsXWayland(display)) {
+            ERRLN("XWayland is currently not supported for the X output.");
+            LOGLN("Set the output to \x1b[;muinput\x1b[1;37m instead.");
+            XCloseDisplay(display);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* The uinput device can only press what it was created with. */
+    int key = LGetCodeByName(EV_KEY, config->press_code);
+    if (LOpenOutput(output, type, display, config->screen, key > 0 ? key : 0)) {
+        LCloseOutput(output);
+        return EXIT_FAILURE;
+    }
+    LOGLNIF(verbose, "Using \x1b[0;37m%s\x1b[1;37m output.", config->output);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns true if the `output` can press the Linux key or button `code`.
+ */
+int LOutputCanPress(EOutput *output, int code)
+{
+    switch (output->type) {
+        case OUTPUT_X:
+            /* X key codes are the Linux ones shifted by 8, like the evdev driver does it. */
+            return output->xtest && (x_button(code) || (code > 0 && code < BTN_MISC));
+        case OUTPUT_UINPUT:
+            return code == BTN_LEFT || (code > 0 && code == output->key);
+        case OUTPUT_NULL:
+            return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Moves the pointer of the `output` to `x`, `y` in 1/256 of a pixel
+ * and presses or releases the `count` `keys` right after, in the same frame.
+ * Fails without output if there are more than `OUTPUT_MAX_KEYS` keys.
+ */
+int LOutputMove(EOutput *output, int x, int y, const EOutputKey *keys, int count)
+{
+    /* Dropping a key could leave it held, the caller has to split the keys instead. */
+    if (count > OUTPUT_MAX_KEYS) {
+        ERRLN("Couldn't output \x1b[0;37m%d\x1b[1;37m keys in one frame, the most is \x1b[0;37m%d\x1b[1;37m.", count, OUTPUT_MAX_KEYS);
+        return EXIT_FAILURE;
+    }
+
+    switch (output->type) {
+        case OUTPUT_X:
+            /* Everything goes out in one flush, so the press can't overtake the warp. */
+            XWarpPointer(output->display, None, output->root_window, 0, 0, 0, 0,
+                x >> TRANSFORM_SUBPIXEL_BITS, y >> TRANSFORM_SUBPIXEL_BITS);
+            for (int i = 0; i < count; i++) {
+                unsigned int button = x_button(keys[i].code);
+                if (button)
+                    XTestFakeButtonEvent(output->display, button, keys[i].value, CurrentTime);
+                else
+                    XTestFakeKeyEvent(output->display, keys[i].code + 8, keys[i].value, CurrentTime);
+            }
+            XFlush(output->display);
+            return EXIT_SUCCESS;
+        case OUTPUT_UINPUT: {
+            /* The axes span the screen whatever its size is now, so the position keeps its place on it. */
+            if (output->width != output->axis_width || output->height != output->axis_height) {
+                x = (int) ((int64_t) x * output->axis_width / output->width);
+                y = (int) ((int64_t) y * output->axis_height / output->height);
+            }
+
+            /* The whole frame is written with a single syscall. */
+            struct input_event ev[3 + 2 * OUTPUT_MAX_KEYS];
+            memset(ev, 0, sizeof(ev));
+            ev[0].type = EV_ABS;
+            ev[0].code = ABS_X;
+            ev[0].value = x;
+            ev[1].type = EV_ABS;
+            ev[1].code = ABS_Y;
+            ev[1].value = y;
+
+            /* A key pressed and released at once needs a frame for each, or readers see no change. */
+            int len = 2, start = 0;
+            for (int i = 0; i < count; i++) {
+                for (int j = start; j < i; j++) {
+                    if (keys[j].code == keys[i].code) {
+                        ev[len].type = EV_SYN;
+                        ev[len++].code = SYN_REPORT;
+                        start = i;
+                        break;
+                    }
+                }
+                ev[len].type = EV_KEY;
+                ev[len].code = keys[i].code;
+                ev[len++].value = keys[i].value;
+            }
+            ev[len].type = EV_SYN;
+            ev[len++].code = SYN_REPORT;
+
+            size_t size = len * sizeof(struct input_event);
+            return write(output->fd, ev, size) == (ssize_t) size ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        case OUTPUT_NULL:
+            return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/*
+ * Closes the `output` backend and its display.
+ */
+void LCloseOutput(EOutput *output)
+{
+    if (output->type == OUTPUT_UINPUT && output->fd >= 0) {
+        ioctl(output->fd, UI_DEV_DESTROY);
+        close(output->fd);
+        output->fd = -1;
+    }
+
+    if (output->display != NULL) {
+        XCloseDisplay(output->display);
+        output->display = NULL;
+    }
+}
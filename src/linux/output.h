@@ -0,0 +1,113 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_OUTPUT_H
+#define _LINUX_OUTPUT_H
+
+#include <X11/Xlib.h>
+
+#include "../config.h"
+
+#define UINPUT_DEV "/dev/uinput"
+#define UINPUT_NAME "abstouch-nux virtual pointer"
+
+/*
+ * Size of the uinput axes when there is no display to take the size from.
+ */
+#define UINPUT_DEFAULT_SIZE 65536
+
+/*
+ * Output backend types.
+ * - OUTPUT_X = Warps the X pointer on the root window.
+ * - OUTPUT_UINPUT = Writes to a virtual absolute pointer through uinput.
+ * - OUTPUT_NULL = Discards the output, for benchmarks and dry runs.
+ */
+#define OUTPUT_X 0
+#define OUTPUT_UINPUT 1
+#define OUTPUT_NULL 2
+
+/*
+ * Maximum count of keys an output frame presses or releases.
+ */
+#define OUTPUT_MAX_KEYS 4
+
+/*
+ * Struct that holds a press (`value` 1) or release (`value` 0) of the Linux key or button `code`.
+ */
+typedef struct {
+    int code;
+    int value;
+} EOutputKey;
+
+/*
+ * Struct that holds an opened output backend.
+ */
+typedef struct {
+    int type;
+
+    /* Size of the output in pixels. */
+    int width;
+    int height;
+
+    Display *display;
+    Window root_window;
+    /* True if X has the XTest extension to press with. */
+    int xtest;
+
+    int fd;
+    /* Key the uinput device can press besides BTN_LEFT, 0 if none. */
+    int key;
+    /* Size the uinput axes were created with, positions are scaled to it once the screen has another size. */
+    int axis_width;
+    int axis_height;
+} EOutput;
+
+/*
+ * Returns the output backend type with the given `name` or -1 if unknown.
+ */
+int LGetOutputType(char *name);
+
+/*
+ * Opens the output backend with the `type` into `output`, which can press `key` besides BTN_LEFT.
+ * `display` can be NULL for backends that don't need X, `key` 0 if it isn't needed.
+ * The `output` takes the `display` over and closes it with itself.
+ */
+int LOpenOutput(EOutput *output, int type, Display *display, int screen, int key);
+
+/*
+ * Opens the display and the output backend in `config` into `output`.
+ */
+int LOpenConfiguredOutput(EOutput *output, EConfig *config, int verbose);
+
+/*
+ * Returns true if the `output` can press the Linux key or button `code`.
+ */
+int LOutputCanPress(EOutput *output, int code);
+
+/*
+ * Moves the pointer of the `output` to `x`, `y` in 1/256 of a pixel
+ * and presses or releases the `count` `keys` right after, in the same frame.
+ * Fails without output if there are more than `OUTPUT_MAX_KEYS` keys.
+ */
+int LOutputMove(EOutput *output, int x, int y, const EOutputKey *keys, int count);
+
+/*
+ * Closes the `output` backend and its display.
+ */
+void LCloseOutput(EOutput *output);
+
+#endif /* _LINUX_OUTPUT_H */
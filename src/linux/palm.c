@@ -0,0 +1,133 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "palm.h"
+
+#include <string.h>
+#include <linux/input.h>
+
+/*
+ * Reads the range of the axis `code` in `axes` into `range`.
+ */
+static void read_range(const EAxes *axes, int code, EPalmRange *range)
+{
+    range->min = range->max = 0;
+    if (!LHasAxis(axes, code))
+        return;
+
+    range->min = axes->absinfo[code].minimum;
+    range->max = axes->absinfo[code].maximum;
+}
+
+/*
+ * Returns true if `value` is at least `threshold` of the `range`.
+ * Axes the device doesn't report never are.
+ */
+static int exceeds(EPalmRange *range, int value, double threshold)
+{
+    if (range->max <= range->min)
+        return 0;
+
+    return (double) (value - range->min) / (range->max - range->min) >= threshold;
+}
+
+/*
+ * Classifies the contact in `index` with `size` and `pressure` on the axes `size_range` and `pressure_range`.
+ * Returns true if it must not be used.
+ */
+static int classify(EPalm *palm, int index, uint64_t contact, int forced, EPalmRange *size_range, int size,
+    EPalmRange *pressure_range, int pressure, double time)
+{
+    uint32_t bit = 1u << index;
+    if (palm->contact[index] != contact) {
+        palm->contact[index] = contact;
+        palm->down[index] = time;
+        palm->palms &= ~bit;
+    }
+
+    /* A palm has to shrink below the thresholds by the hysteresis before it is a finger again. */
+    double scale = palm->palms & bit ? 1 - palm->hysteresis : 1;
+    if (forced || exceeds(size_range, size, palm->size * scale) || exceeds(pressure_range, pressure, palm->pressure * scale))
+        palm->palms |= bit;
+    else
+        palm->palms &= ~bit;
+
+    return (palm->palms & bit) || time - palm->down[index] < palm->settle;
+}
+
+/*
+ * Initializes the `palm` classifier with the axis ranges in `axes`.
+ * Without them only the tools reported by the contacts are classified.
+ */
+void LPalmInit(EPalm *palm, const EAxes *axes)
+{
+    memset(palm, 0, sizeof(*palm));
+    read_range(axes, ABS_MT_TOUCH_MAJOR, &palm->touch_major);
+    read_range(axes, ABS_MT_PRESSURE, &palm->mt_pressure);
+    read_range(axes, ABS_TOOL_WIDTH, &palm->width);
+    read_range(axes, ABS_PRESSURE, &palm->st_pressure);
+}
+
+/*
+ * Sets the thresholds of the `palm` classifier from `config`, keeping its state.
+ */
+void LPalmConfigure(EPalm *palm, EConfig *config)
+{
+    palm->enabled = config->palm;
+    palm->size = config->palm_size;
+    palm->pressure = config->palm_pressure;
+    palm->hysteresis = config->palm_hysteresis;
+    palm->settle = config->palm_settle_ms / 1000.0;
+}
+
+/*
+ * Classifies the contacts in `slots` of the frame at `time` seconds.
+ * Returns the slots that must not be used, because they are palms or still settling.
+ */
+uint32_t LPalmClassifySlots(EPalm *palm, ESlots *slots, double time)
+{
+    if (!palm->enabled)
+        return 0;
+
+    uint32_t rejected = 0;
+    for (int i = 0; i < slots->count; i++) {
+        ESlot *slot = &slots->slots[i];
+        if (slot->tracking_id < 0) {
+            palm->palms &= ~(1u << i);
+            continue;
+        }
+
+        if (classify(palm, i, slot->sequence, slot->tool_type == MT_TOOL_PALM, &palm->touch_major, slot->touch_major,
+            &palm->mt_pressure, slot->pressure, time))
+            rejected |= 1u << i;
+    }
+
+    return rejected;
+}
+
+/*
+ * Classifies the `contact` of a single touch device with `fingers` tools, `width` and `pressure`
+ * of the frame at `time` seconds. Returns true if the contact must not be used.
+ */
+int LPalmClassify(EPalm *palm, uint64_t contact, int fingers, int width, int pressure, double time)
+{
+    if (!palm->enabled)
+        return 0;
+
+    /* Without slots, more than one finger can't be told apart from a finger and a palm. */
+    return classify(palm, 0, contact, fingers > 1, &palm->width, width, &palm->st_pressure, pressure, time);
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_PALM_H
+#define _LINUX_PALM_H
+
+#include "slots.h"
+#include "../config.h"
+
+#include <stdint.h>
+
+/*
+ * Struct that holds the range of an axis the contacts are classified on.
+ * `max` equals `min` if the device doesn't report the axis.
+ */
+typedef struct {
+    int min;
+    int max;
+} EPalmRange;
+
+/*
+ * Struct that classifies the contacts of a frame into fingers and palms.
+ */
+typedef struct {
+    int enabled;
+
+    /* Fractions of the axis ranges from which a contact is a palm, and how far below them it stops being one. */
+    double size;
+    double pressure;
+    double hysteresis;
+    /* Time in seconds a new contact is held back before it can be used. */
+    double settle;
+
+    /* Ranges of the multitouch size and pressure, and of the single touch width and pressure. */
+    EPalmRange touch_major;
+    EPalmRange mt_pressure;
+    EPalmRange width;
+    EPalmRange st_pressure;
+
+    /* Contact each slot was classified for, when it went down, and the slots that are palms. */
+    uint64_t contact[SLOTS_MAX];
+    double down[SLOTS_MAX];
+    uint32_t palms;
+} EPalm;
+
+/*
+ * Initializes the `palm` classifier with the axis ranges in `axes`.
+ * Without them only the tools reported by the contacts are classified.
+ */
+void LPalmInit(EPalm *palm, const EAxes *axes);
+
+/*
+ * Sets the thresholds of the `palm` classifier from `config`, keeping its state.
+ */
+void LPalmConfigure(EPalm *palm, EConfig *config);
+
+/*
+ * Classifies the contacts in `slots` of the frame at `time` seconds.
+ * Returns the slots that must not be used, because they are palms or still settling.
+ */
+uint32_t LPalmClassifySlots(EPalm *palm, ESlots *slots, double time);
+
+/*
+ * Classifies the `contact` of a single touch device with `fingers` tools, `width` and `pressure`
+ * of the frame at `time` seconds. Returns true if the contact must not be used.
+ */
+int LPalmClassify(EPalm *palm, uint64_t contact, int fingers, int width, int pressure, double time);
+
+#endif /* _LINUX_PALM_H */
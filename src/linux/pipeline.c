@@ -0,0 +1,277 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "pipeline.h"
+#include "../print.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Builds the `transform` from the limits in `config` to the area of `target` on `output`.
+ */
+static int build_transform(ETransform *transform, EConfig *config, ETarget *target, EOutput *output)
+{
+    ERect rect = LTargetRect(target, output->width, output->height);
+
+    /* The homography already maps to the screen, so orientation and mirror don't apply to it. */
+    if (strcmp(config->homography, "none")) {
+        double h[9];
+        if (TParseHomography(config->homography, h) || TBuildProjectiveTransform(transform, h, rect,
+            config->x_min, config->x_max, config->y_min, config->y_max)) {
+            ERRLN("Homography must be \x1b[0;37mnone\x1b[1;37m or the nine comma separated numbers of a 3x3 matrix.");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (TBuildTransform(transform, config->x_min, config->x_max, config->y_min, config->y_max,
+        rect, config->orientation, config->mirror)) {
+        ERRLN("Orientation must be \x1b[0;37m0\x1b[1;37m, \x1b[0;37m90\x1b[1;37m, \x1b[0;37m180\x1b[1;37m or \x1b[0;37m270\x1b[1;37m.");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Initializes the `pipeline` with the limits in `config` and the device axes in `axes`,
+ * reading from `fd` to `output`.
+ */
+static int init(EPipeline *pipeline, EConfig *config, int fd, const EAxes *axes, EOutput *output)
+{
+    memset(pipeline, 0, sizeof(*pipeline));
+    LFrameInitAxes(&pipeline->assembler, fd, axes);
+    LPressInit(&pipeline->press, axes);
+    pipeline->output = output;
+    pipeline->clock = CLOCK_MONOTONIC;
+    if (LOpenTarget(&pipeline->target, config->target, output->display, output->root_window, output->width, output->height))
+        return EXIT_FAILURE;
+
+    ECorrection correction;
+    if (LPipelineOpenCorrection(config, &correction))
+        return EXIT_FAILURE;
+    if (LPipelineConfigure(pipeline, config, &correction)) {
+        LCloseCorrection(&correction);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Initializes the `pipeline` with the limits in `config`, reading from `fd` to `output`.
+ * `fd` can be negative if the events don't come from a device.
+ */
+int LPipelineInit(EPipeline *pipeline, EConfig *config, int fd, EOutput *output)
+{
+    EAxes axes;
+    LReadAxes(fd, &axes);
+    return init(pipeline, config, fd, &axes, output);
+}
+
+/*
+ * Initializes the `pipeline` with the limits in `config` for the events of a device with `axes`
+ * that isn't there, like the one of a recording, to `output`.
+ */
+int LPipelineInitAxes(EPipeline *pipeline, EConfig *config, const EAxes *axes, EOutput *output)
+{
+    return init(pipeline, config, -1, axes, output);
+}
+
+/*
+ * Maps the correction table `config` asks for into `correction`, which is left empty if there is none.
+ * Doesn't touch any pipeline, so a reload can read the file off the input thread.
+ */
+int LPipelineOpenCorrection(EConfig *config, ECorrection *correction)
+{
+    memset(correction, 0, sizeof(*correction));
+    if (!config->correction)
+        return EXIT_SUCCESS;
+
+    char path[4096];
+    LGetCorrectionPath(config->profile, path, sizeof(path));
+    return LOpenCorrection(correction, path);
+}
+
+/*
+ * Rebuilds the filter and the transform of the `pipeline` from `config`, and swaps in the table in `correction`.
+ * The table that was replaced is left in `correction` for the caller to close.
+ * The `pipeline` and `correction` are left untouched if `config` is invalid.
+ */
+int LPipelineConfigure(EPipeline *pipeline, EConfig *config, ECorrection *correction)
+{
+    EFilter filter;
+    if (FInitFilter(&filter, config)) {
+        ERRLN("Unknown filter: \x1b[;m%s", config->filter);
+        return EXIT_FAILURE;
+    }
+
+    if (LGetSlotPolicy(config->contact) < 0) {
+        ERRLN("Contact must be \x1b[0;37mfirst\x1b[1;37m, \x1b[0;37mrecent\x1b[1;37m or \x1b[0;37mpressure\x1b[1;37m.");
+        return EXIT_FAILURE;
+    }
+
+    EOutput *output = pipeline->output;
+    EPress press = pipeline->press;
+    if (LGetPressMode(config->press) < 0) {
+        ERRLN("Press must be \x1b[0;37mnone\x1b[1;37m, \x1b[0;37mtouch\x1b[1;37m, \x1b[0;37mpressure\x1b[1;37m or \x1b[0;37mtap\x1b[1;37m.");
+        return EXIT_FAILURE;
+    }
+    if (LPressConfigure(&press, config, output)) {
+        ERRLN("Couldn't press \x1b[;m%s\x1b[1;37m with the \x1b[;m%s\x1b[1;37m output.", config->press_code, config->output);
+        LOGLN("A new key needs a restart with the uinput output, and the X output needs XTest.");
+        return EXIT_FAILURE;
+    }
+
+    /* The target is only resolved again if it has changed. */
+    ETarget target = pipeline->target;
+    if (strcmp(target.spec, config->target) && LOpenTarget(&target, config->target, output->display,
+        output->root_window, output->width, output->height))
+        return EXIT_FAILURE;
+
+    ETransform transform;
+    if (build_transform(&transform, config, &target, output))
+        return EXIT_FAILURE;
+
+    /* A held key must not get stuck when another one takes its place. */
+    if (press.code != pipeline->press.code || press.mode != pipeline->press.mode)
+        LPipelineRelease(pipeline);
+    press.pressed = pipeline->press.pressed;
+
+    LFrameConfigure(&pipeline->assembler, config);
+    pipeline->press = press;
+    pipeline->filter = filter;
+    pipeline->target = target;
+    pipeline->transform = transform;
+
+    /* The table is mapped again on every reload, a new calibration replaces the file. */
+    ECorrection old = pipeline->correction;
+    pipeline->correction = *correction;
+    *correction = old;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Unmaps the correction table of the `pipeline`.
+ */
+void LPipelineClose(EPipeline *pipeline)
+{
+    LCloseCorrection(&pipeline->correction);
+}
+
+/*
+ * Rebuilds the transform of the `pipeline` from `config` after the geometry of its target has changed.
+ */
+int LPipelineRetarget(EPipeline *pipeline, EConfig *config)
+{
+    /* Positions are in root pixels, the uinput output scales them to the range it was created with. */
+    EOutput *output = pipeline->output;
+    output->width = pipeline->target.root_width;
+    output->height = pipeline->target.root_height;
+
+    return build_transform(&pipeline->transform, config, &pipeline->target, output);
+}
+
+/*
+ * Maps the latest complete frame of the `pipeline` to the output and presses or releases the `count` `keys` with it.
+ * `frames` is the count of frames completed since the last output.
+ */
+static int send_frame(EPipeline *pipeline, const EOutputKey *keys, int count, int frames)
+{
+    /* Palms never move the cursor but can release. */
+    EFrame *frame = &pipeline->assembler.frame;
+    pipeline->pending = 0;
+    if (frame->rejected)
+        return count ? LOutputMove(pipeline->output, pipeline->position.x, pipeline->position.y, keys, count) : EXIT_SUCCESS;
+
+    int x = frame->x, y = frame->y;
+    if (pipeline->correction.header != NULL)
+        LCorrect(&pipeline->correction, &x, &y);
+
+    /* Another finger is somewhere else, so the filter must not smooth across the jump. */
+    if (frame->contact != pipeline->contact) {
+        pipeline->contact = frame->contact;
+        pipeline->filter.initialized = 0;
+    }
+    FApplyFilter(&pipeline->filter, frame->time.tv_sec + frame->time.tv_usec / 1e6, &x, &y);
+
+    pipeline->position = TApplyTransform(&pipeline->transform, x, y);
+    pipeline->cx = pipeline->position.x >> TRANSFORM_SUBPIXEL_BITS;
+    pipeline->cy = pipeline->position.y >> TRANSFORM_SUBPIXEL_BITS;
+    int result = LOutputMove(pipeline->output, pipeline->position.x, pipeline->position.y, keys, count);
+
+    if (pipeline->stats != NULL) {
+        uint64_t frame_ns = (uint64_t) frame->time.tv_sec * 1000000000ULL + frame->time.tv_usec * 1000ULL;
+        uint64_t now_ns = LStatsNow(pipeline->clock);
+        LStatsRecord(pipeline->stats, now_ns > frame_ns ? now_ns - frame_ns : 0, frames);
+    }
+
+    return result;
+}
+
+/*
+ * Pushes `count` events from `ev` to the `pipeline`, updating the presses on every frame completed.
+ * A frame that presses or releases is sent right away with its own position.
+ * Returns the count of frames completed.
+ */
+int LPipelineFeed(EPipeline *pipeline, const struct input_event *ev, int count)
+{
+    int frames = 0;
+    for (int i = 0; i < count; i++) {
+        if (!LFramePush(&pipeline->assembler, &ev[i]))
+            continue;
+        frames++;
+        pipeline->pending++;
+
+        /* Only frames without a press or release are coalesced, a tap shorter than a read must still click. */
+        EOutputKey keys[OUTPUT_MAX_KEYS];
+        int key_count = LPressUpdate(&pipeline->press, &pipeline->assembler, keys);
+        if (key_count)
+            send_frame(pipeline, keys, key_count, pipeline->pending);
+    }
+    return frames;
+}
+
+/*
+ * Maps the latest complete frame to the output, unless it has already been sent with a press or release.
+ */
+int LPipelineOutput(EPipeline *pipeline)
+{
+    if (!pipeline->pending)
+        return EXIT_SUCCESS;
+    return send_frame(pipeline, NULL, 0, pipeline->pending);
+}
+
+/*
+ * Maps the latest complete frame to the output whether or not it has been sent already.
+ */
+int LPipelineMap(EPipeline *pipeline)
+{
+    return send_frame(pipeline, NULL, 0, 1);
+}
+
+/*
+ * Releases the key the `pipeline` holds pressed, at the latest position.
+ */
+int LPipelineRelease(EPipeline *pipeline)
+{
+    EOutputKey keys[1];
+    if (!LPressRelease(&pipeline->press, keys))
+        return EXIT_SUCCESS;
+
+    return LOutputMove(pipeline->output, pipeline->position.x, pipeline->position.y, keys, 1);
+}
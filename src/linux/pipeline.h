@@ -0,0 +1,122 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_PIPELINE_H
+#define _LINUX_PIPELINE_H
+
+#include "frame.h"
+#include "output.h"
+#include "stats.h"
+#include "target.h"
+#include "press.h"
+#include "correction.h"
+#include "../config.h"
+#include "../transform.h"
+#include "../filter.h"
+
+#include <time.h>
+
+/*
+ * Struct that holds the mapping pipeline from evdev events to the output.
+ */
+typedef struct {
+    EFrameAssembler assembler;
+    EOutput *output;
+
+    /* Clock of the event timestamps and where their latency is recorded, can be NULL. */
+    clockid_t clock;
+    EStats *stats;
+
+    /* Table the positions are corrected with before anything else, unless its header is NULL. */
+    ECorrection correction;
+
+    EFilter filter;
+    ETarget target;
+
+    /* Contact the filter is following. */
+    uint64_t contact;
+
+    EPress press;
+    ETransform transform;
+
+    /* Count of frames completed since the last output. */
+    int pending;
+
+    /* Latest position sent to the output, and the same in whole pixels. */
+    EPoint position;
+    int cx;
+    int cy;
+} EPipeline;
+
+/*
+ * Initializes the `pipeline` with the limits in `config`, reading from `fd` to `output`.
+ * `fd` can be negative if the events don't come from a device.
+ */
+int LPipelineInit(EPipeline *pipeline, EConfig *config, int fd, EOutput *output);
+
+/*
+ * Initializes the `pipeline` with the limits in `config` for the events of a device with `axes`
+ * that isn't there, like the one of a recording, to `output`.
+ */
+int LPipelineInitAxes(EPipeline *pipeline, EConfig *config, const EAxes *axes, EOutput *output);
+
+/*
+ * Maps the correction table `config` asks for into `correction`, which is left empty if there is none.
+ * Doesn't touch any pipeline, so a reload can read the file off the input thread.
+ */
+int LPipelineOpenCorrection(EConfig *config, ECorrection *correction);
+
+/*
+ * Rebuilds the filter and the transform of the `pipeline` from `config`, and swaps in the table in `correction`.
+ * The table that was replaced is left in `correction` for the caller to close.
+ * The `pipeline` and `correction` are left untouched if `config` is invalid.
+ */
+int LPipelineConfigure(EPipeline *pipeline, EConfig *config, ECorrection *correction);
+
+/*
+ * Unmaps the correction table of the `pipeline`.
+ */
+void LPipelineClose(EPipeline *pipeline);
+
+/*
+ * Rebuilds the transform of the `pipeline` from `config` after the geometry of its target has changed.
+ */
+int LPipelineRetarget(EPipeline *pipeline, EConfig *config);
+
+/*
+ * Pushes `count` events from `ev` to the `pipeline`, updating the presses on every frame completed.
+ * A frame that presses or releases is sent right away with its own position.
+ * Returns the count of frames completed.
+ */
+int LPipelineFeed(EPipeline *pipeline, const struct input_event *ev, int count);
+
+/*
+ * Maps the latest complete frame to the output, unless it has already been sent with a press or release.
+ */
+int LPipelineOutput(EPipeline *pipeline);
+
+/*
+ * Maps the latest complete frame to the output whether or not it has been sent already.
+ */
+int LPipelineMap(EPipeline *pipeline);
+
+/*
+ * Releases the key the `pipeline` holds pressed, at the latest position.
+ */
+int LPipelineRelease(EPipeline *pipeline);
+
+#endif /* _LINUX_PIPELINE_H */
@@ -0,0 +1,154 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "press.h"
+#include "event.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Returns the press mode with the given `name` or -1 if unknown.
+ */
+int LGetPressMode(char *name)
+{
+    if (!strcmp(name, "none"))
+        return PRESS_NONE;
+    else if (!strcmp(name, "touch"))
+        return PRESS_TOUCH;
+    else if (!strcmp(name, "pressure"))
+        return PRESS_PRESSURE;
+    else if (!strcmp(name, "tap"))
+        return PRESS_TAP;
+    return -1;
+}
+
+/*
+ * Initializes the `press` engine with the pressure ranges in `axes`.
+ * Without them the pressure mode never presses.
+ */
+void LPressInit(EPress *press, const EAxes *axes)
+{
+    memset(press, 0, sizeof(*press));
+
+    if (LHasAxis(axes, ABS_MT_PRESSURE)) {
+        press->mt_pressure_min = axes->absinfo[ABS_MT_PRESSURE].minimum;
+        press->mt_pressure_max = axes->absinfo[ABS_MT_PRESSURE].maximum;
+    }
+    if (LHasAxis(axes, ABS_PRESSURE)) {
+        press->st_pressure_min = axes->absinfo[ABS_PRESSURE].minimum;
+        press->st_pressure_max = axes->absinfo[ABS_PRESSURE].maximum;
+    }
+}
+
+/*
+ * Sets the mode, the key and the thresholds of the `press` engine from `config`, keeping its state.
+ * Fails without changing `press` if the key is unknown or the `output` can't press it.
+ */
+int LPressConfigure(EPress *press, EConfig *config, EOutput *output)
+{
+    int mode = LGetPressMode(config->press);
+    int code = LGetCodeByName(EV_KEY, config->press_code);
+    if (mode < 0 || code <= 0 || (mode != PRESS_NONE && !LOutputCanPress(output, code)))
+        return EXIT_FAILURE;
+
+    press->mode = mode;
+    press->code = code;
+    press->pressure = config->press_pressure;
+    press->hysteresis = config->press_hysteresis;
+    press->tap_time = config->press_tap_ms / 1000.0;
+    press->tap_move = (int) (config->press_tap_move * abs(config->x_max - config->x_min));
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns true if the pressure of the `frame` is above the threshold of the `press` engine,
+ * or above the lower one if it is already pressed.
+ */
+static int pressure_pressed(EPress *press, EFrame *frame, int multitouch)
+{
+    int min = multitouch ? press->mt_pressure_min : press->st_pressure_min;
+    int max = multitouch ? press->mt_pressure_max : press->st_pressure_max;
+    if (max <= min)
+        return 0;
+
+    double threshold = press->pressed ? press->pressure * (1 - press->hysteresis) : press->pressure;
+    return (double) (frame->pressure - min) / (max - min) >= threshold;
+}
+
+/*
+ * Updates the `press` engine with the `frame` of `assembler`.
+ * Returns the count of presses and releases written to `keys`, at most 2.
+ */
+int LPressUpdate(EPress *press, EFrameAssembler *assembler, EOutputKey *keys)
+{
+    if (press->mode == PRESS_NONE)
+        return 0;
+
+    EFrame *frame = &assembler->frame;
+    double time = frame->time.tv_sec + frame->time.tv_usec / 1e6;
+    int touching = frame->contacts > 0 && !frame->rejected;
+    int down = touching && !press->touching;
+    int up = !touching && press->touching;
+    press->touching = touching;
+
+    if (down) {
+        press->down = time;
+        press->down_x = frame->x;
+        press->down_y = frame->y;
+        press->moved = 0;
+    } else if (touching && (abs(frame->x - press->down_x) > press->tap_move || abs(frame->y - press->down_y) > press->tap_move))
+        press->moved = 1;
+
+    int pressed = 0;
+    switch (press->mode) {
+        case PRESS_TOUCH:
+            pressed = touching;
+            break;
+        case PRESS_PRESSURE:
+            pressed = touching && pressure_pressed(press, frame, assembler->slots.multitouch && assembler->slots.pressure);
+            break;
+        case PRESS_TAP:
+            /* A tap is a whole click once the contact is lifted. */
+            if (!up || press->moved || time - press->down > press->tap_time)
+                return 0;
+            keys[0] = (EOutputKey) {.code = press->code, .value = 1};
+            keys[1] = (EOutputKey) {.code = press->code, .value = 0};
+            return 2;
+    }
+
+    if (pressed == press->pressed)
+        return 0;
+
+    press->pressed = pressed;
+    keys[0] = (EOutputKey) {.code = press->code, .value = pressed};
+    return 1;
+}
+
+/*
+ * Releases the key of the `press` engine if it is held.
+ * Returns the count of releases written to `keys`, at most 1.
+ */
+int LPressRelease(EPress *press, EOutputKey *keys)
+{
+    if (!press->pressed)
+        return 0;
+
+    press->pressed = 0;
+    keys[0] = (EOutputKey) {.code = press->code, .value = 0};
+    return 1;
+}
@@ -0,0 +1,93 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_PRESS_H
+#define _LINUX_PRESS_H
+
+#include "frame.h"
+#include "output.h"
+#include "../config.h"
+
+/*
+ * Press modes.
+ * - PRESS_NONE = Never presses.
+ * - PRESS_TOUCH = Holds the key while something touches, following BTN_TOUCH or the contacts.
+ * - PRESS_PRESSURE = Holds the key while the pressure is above the threshold.
+ * - PRESS_TAP = Clicks the key when a contact is lifted quickly without moving.
+ */
+#define PRESS_NONE 0
+#define PRESS_TOUCH 1
+#define PRESS_PRESSURE 2
+#define PRESS_TAP 3
+
+/*
+ * Struct that turns the touch state of the frames into presses of a key or button.
+ */
+typedef struct {
+    int mode;
+    int code;
+
+    /* Fraction of the pressure range to press at, and how far below it the key is released. */
+    double pressure;
+    double hysteresis;
+    /* Longest tap in seconds and the farthest it can move in device units. */
+    double tap_time;
+    int tap_move;
+
+    /* Pressure ranges of the contacts and of the single touch pressure, `max` equals `min` if there are none. */
+    int mt_pressure_min, mt_pressure_max;
+    int st_pressure_min, st_pressure_max;
+
+    int touching;
+    int pressed;
+
+    /* Where and when the current contact went down, and if it has moved too far for a tap. */
+    double down;
+    int down_x, down_y;
+    int moved;
+} EPress;
+
+/*
+ * Returns the press mode with the given `name` or -1 if unknown.
+ */
+int LGetPressMode(char *name);
+
+/*
+ * Initializes the `press` engine with the pressure ranges in `axes`.
+ * Without them the pressure mode never presses.
+ */
+void LPressInit(EPress *press, const EAxes *axes);
+
+/*
+ * Sets the mode, the key and the thresholds of the `press` engine from `config`, keeping its state.
+ * Fails without changing `press` if the key is unknown or the `output` can't press it.
+ */
+int LPressConfigure(EPress *press, EConfig *config, EOutput *output);
+
+/*
+ * Updates the `press` engine with the `frame` of `assembler`.
+ * Returns the count of presses and releases written to `keys`, at most 2.
+ */
+int LPressUpdate(EPress *press, EFrameAssembler *assembler, EOutputKey *keys);
+
+/*
+ * Releases the key of the `press` engine if it is held.
+ * Returns the count of releases written to `keys`, at most 1.
+ */
+int LPressRelease(EPress *press, EOutputKey *keys);
+
+#endif /* _LINUX_PRESS_H */
@@ -0,0 +1,232 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#define _GNU_SOURCE
+#include "probe.h"
+#include "event.h"
+#include "../config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+/*
+ * Fills the node identity of the event `event` into `info`.
+ */
+static int identify_node(int event, EDeviceInfo *info)
+{
+    char path[64];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/%s%d", DEV_INPUT_DIR, EVENT_PREFIX, event);
+    if (stat(path, &st) < 0)
+        return EXIT_FAILURE;
+
+    memset(info, 0, sizeof(*info));
+    info->event = event;
+    info->rdev = st.st_rdev;
+    info->mtime_ns = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+    /* The sysfs path changes whenever the device is reconnected, even if the event id is reused. */
+    snprintf(path, sizeof(path), "/sys/class/input/%s%d", EVENT_PREFIX, event);
+    ssize_t len = readlink(path, info->sysfs, sizeof(info->sysfs) - 1);
+    info->sysfs[len > 0 ? len : 0] = '\0';
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns the path of the device cache.
+ */
+static char *cache_path(void)
+{
+    char *dir = CGetConfigDir();
+    size_t len = strlen(dir) + strlen(PROBE_CACHE_FILE) + 2;
+    char *path = malloc(len);
+    snprintf(path, len, "%s/%s", dir, PROBE_CACHE_FILE);
+    free(dir);
+    return path;
+}
+
+/*
+ * Reads the device cache and sets `count`, returns NULL if there is no valid cache.
+ */
+static EDeviceInfo *read_cache(int *count)
+{
+    char *path = cache_path();
+    FILE *f = fopen(path, "rb");
+    free(path);
+    *count = 0;
+    if (f == NULL)
+        return NULL;
+
+    EProbeCacheHeader header;
+    EDeviceInfo *devices = NULL;
+    if (fread(&header, sizeof(header), 1, f) == 1 && !memcmp(header.magic, PROBE_CACHE_MAGIC, 4)
+        && header.version == PROBE_CACHE_VERSION && header.record_size == sizeof(EDeviceInfo)) {
+        devices = malloc((header.count ? header.count : 1) * sizeof(EDeviceInfo));
+        if (fread(devices, sizeof(EDeviceInfo), header.count, f) == header.count)
+            *count = header.count;
+        else {
+            free(devices);
+            devices = NULL;
+        }
+    }
+
+    fclose(f);
+    return devices;
+}
+
+/*
+ * Replaces the device cache with `count` `devices`.
+ */
+static void write_cache(EDeviceInfo *devices, int count)
+{
+    char *path = cache_path();
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+
+    FILE *f = fopen(tmp, "wb");
+    if (f == NULL) {
+        free(path);
+        return;
+    }
+
+    EProbeCacheHeader header = {.version = PROBE_CACHE_VERSION, .record_size = sizeof(EDeviceInfo), .count = count};
+    memcpy(header.magic, PROBE_CACHE_MAGIC, 4);
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(devices, sizeof(EDeviceInfo), count, f) == (size_t) count;
+    if (fclose(f) || !ok || rename(tmp, path))
+        unlink(tmp);
+    free(path);
+}
+
+/*
+ * Probes all capabilities of the event `fd` into `info`.
+ */
+int LProbeDevice(int fd, EDeviceInfo *info)
+{
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(info->ev_bits)), info->ev_bits) < 0)
+        return EXIT_FAILURE;
+
+    ioctl(fd, EVIOCGNAME(sizeof(info->name) - 1), info->name);
+    ioctl(fd, EVIOCGPHYS(sizeof(info->phys) - 1), info->phys);
+    ioctl(fd, EVIOCGUNIQ(sizeof(info->uniq) - 1), info->uniq);
+    ioctl(fd, EVIOCGID, &info->id);
+    if (PROBE_TEST_BIT(EV_KEY, info->ev_bits))
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(info->key_bits)), info->key_bits);
+    if (!PROBE_TEST_BIT(EV_ABS, info->ev_bits))
+        return EXIT_SUCCESS;
+
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(info->abs_bits)), info->abs_bits);
+    for (int code = 0; code < ABS_CNT; code++) {
+        if (PROBE_TEST_BIT(code, info->abs_bits))
+            ioctl(fd, EVIOCGABS(code), &info->absinfo[code]);
+    }
+    if (PROBE_TEST_BIT(ABS_MT_SLOT, info->abs_bits))
+        info->slots = info->absinfo[ABS_MT_SLOT].maximum + 1;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Returns the capabilities of every input event and sets `count`.
+ * Devices that haven't changed since the last call are read from the cache instead of being opened.
+ */
+EDeviceInfo *LProbeDevices(int *count)
+{
+    *count = 0;
+    struct dirent **namelist;
+    int ndev = scandir(DEV_INPUT_DIR, &namelist, LIsEventDevice, versionsort);
+    if (ndev < 0)
+        return NULL;
+
+    int cached_count;
+    EDeviceInfo *cached = read_cache(&cached_count);
+    EDeviceInfo *devices = malloc((ndev ? ndev : 1) * sizeof(EDeviceInfo));
+    int changed = cached == NULL;
+
+    for (int i = 0; i < ndev; i++) {
+        int event;
+        EDeviceInfo *info = &devices[*count];
+        if (sscanf(namelist[i]->d_name, EVENT_PREFIX "%d", &event) != 1 || identify_node(event, info)) {
+            free(namelist[i]);
+            continue;
+        }
+        free(namelist[i]);
+
+        EDeviceInfo *old = LFindDevice(cached, cached_count, event);
+        if (old != NULL && old->rdev == info->rdev && old->mtime_ns == info->mtime_ns
+            && !strcmp(old->sysfs, info->sysfs)) {
+            *info = *old;
+            (*count)++;
+            continue;
+        }
+
+        /* Devices that can't be opened aren't cached, they might become readable later. */
+        int fd = LOpenEvent(event);
+        if (fd < 0)
+            continue;
+        if (!LProbeDevice(fd, info)) {
+            (*count)++;
+            changed = 1;
+        }
+        close(fd);
+    }
+    free(namelist);
+
+    if (changed || cached_count != *count)
+        write_cache(devices, *count);
+    free(cached);
+    return devices;
+}
+
+/*
+ * Returns the device with `event` id in `devices`, or NULL.
+ */
+EDeviceInfo *LFindDevice(EDeviceInfo *devices, int count, int event)
+{
+    for (int i = 0; i < count; i++) {
+        if (devices[i].event == event)
+            return &devices[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns the first device named `name` in `devices`, or NULL.
+ */
+EDeviceInfo *LFindDeviceByName(EDeviceInfo *devices, int count, char *name)
+{
+    for (int i = 0; i < count; i++) {
+        if (!strcmp(devices[i].name, name))
+            return &devices[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * Returns true if the `device` has absolute input.
+ */
+int LIsAbsoluteDevice(EDeviceInfo *device)
+{
+    return PROBE_TEST_BIT(EV_ABS, device->ev_bits);
+}
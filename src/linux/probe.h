@@ -0,0 +1,92 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_PROBE_H
+#define _LINUX_PROBE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <linux/input.h>
+
+#define PROBE_CACHE_FILE "devices.cache"
+#define PROBE_CACHE_MAGIC "ATDC"
+#define PROBE_CACHE_VERSION 1
+
+#define PROBE_LONGS(bits) (((bits) + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long)))
+#define PROBE_TEST_BIT(bit, array) (((array)[(bit) / (8 * sizeof(unsigned long))] >> ((bit) % (8 * sizeof(unsigned long)))) & 1)
+
+/*
+ * Struct that holds everything abstouch-nux needs to know about an input event.
+ * `sysfs`, `rdev` and `mtime_ns` identify the device node it was probed from.
+ */
+typedef struct {
+    int event;
+    char sysfs[256];
+    uint64_t rdev;
+    int64_t mtime_ns;
+
+    char name[256];
+    char phys[256];
+    char uniq[256];
+    struct input_id id;
+
+    unsigned long ev_bits[PROBE_LONGS(EV_CNT)];
+    unsigned long abs_bits[PROBE_LONGS(ABS_CNT)];
+    unsigned long key_bits[PROBE_LONGS(KEY_CNT)];
+    struct input_absinfo absinfo[ABS_CNT];
+
+    /* Count of multitouch slots, 0 if the device isn't multitouch. */
+    int slots;
+} EDeviceInfo;
+
+/*
+ * Header of the device cache file, followed by `count` device records.
+ */
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+} EProbeCacheHeader;
+
+/*
+ * Probes all capabilities of the event `fd` into `info`.
+ */
+int LProbeDevice(int fd, EDeviceInfo *info);
+
+/*
+ * Returns the capabilities of every input event and sets `count`.
+ * Devices that haven't changed since the last call are read from the cache instead of being opened.
+ */
+EDeviceInfo *LProbeDevices(int *count);
+
+/*
+ * Returns the device with `event` id in `devices`, or NULL.
+ */
+EDeviceInfo *LFindDevice(EDeviceInfo *devices, int count, int event);
+
+/*
+ * Returns the first device named `name` in `devices`, or NULL.
+ */
+EDeviceInfo *LFindDeviceByName(EDeviceInfo *devices, int count, char *name);
+
+/*
+ * Returns true if the `device` has absolute input.
+ */
+int LIsAbsoluteDevice(EDeviceInfo *device);
+
+#endif /* _LINUX_PROBE_H */
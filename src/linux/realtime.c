@@ -0,0 +1,90 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#define _GNU_SOURCE
+#include "realtime.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+/*
+ * Faults in `REALTIME_STACK_PREFAULT` bytes of stack below the caller.
+ */
+static void __attribute__((noinline)) prefault_stack(void)
+{
+    volatile unsigned char stack[REALTIME_STACK_PREFAULT];
+    for (size_t i = 0; i < sizeof(stack); i += 4096)
+        stack[i] = 0;
+}
+
+/*
+ * Applies the realtime settings in `config` to the calling thread where permitted.
+ * Returns the realtime guarantees that are active, the memory is locked by `LLockMemory`.
+ */
+int LApplyRealtime(EConfig *config)
+{
+    if (!config->realtime)
+        return 0;
+
+    int guarantees = 0;
+
+    if (config->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config->cpu, &set);
+        if (!sched_setaffinity(0, sizeof(set), &set))
+            guarantees |= REALTIME_AFFINITY;
+    }
+
+    prefault_stack();
+    guarantees |= REALTIME_PREFAULT;
+
+    int policy = !strcmp(config->realtime_policy, "rr") ? SCHED_RR : SCHED_FIFO;
+    int min = sched_get_priority_min(policy), max = sched_get_priority_max(policy);
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = config->realtime_priority < min ? min : config->realtime_priority > max ? max : config->realtime_priority;
+    if (!sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param))
+        guarantees |= REALTIME_SCHED;
+
+    return guarantees;
+}
+
+/*
+ * Locks all memory of the process, once every thread and connection is set up.
+ * Returns REALTIME_MLOCK if it was locked, 0 otherwise.
+ */
+int LLockMemory(void)
+{
+    /* Locking also faults in everything that is mapped so far, the stacks of the threads included. */
+    return mlockall(MCL_CURRENT | MCL_FUTURE) ? 0 : REALTIME_MLOCK;
+}
+
+/*
+ * Prints the active realtime `guarantees`.
+ */
+void LPrintRealtime(int guarantees)
+{
+    LOGLN("Realtime scheduling => \x1b[0;37m%s", guarantees & REALTIME_SCHED ? "Yes" : "No");
+    LOGLN("Locked memory => \x1b[0;37m%s", guarantees & REALTIME_MLOCK ? "Yes" : "No");
+    LOGLN("CPU affinity => \x1b[0;37m%s", guarantees & REALTIME_AFFINITY ? "Yes" : "No");
+    LOGLN("Prefaulted stack => \x1b[0;37m%s", guarantees & REALTIME_PREFAULT ? "Yes" : "No");
+}
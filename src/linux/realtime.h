@@ -0,0 +1,57 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_REALTIME_H
+#define _LINUX_REALTIME_H
+
+#include "../config.h"
+
+/*
+ * Realtime guarantees that can be active.
+ * - REALTIME_SCHED = Runs with the SCHED_FIFO or SCHED_RR policy.
+ * - REALTIME_MLOCK = All memory is locked and can't be swapped out.
+ * - REALTIME_AFFINITY = Pinned to the configured CPU.
+ * - REALTIME_PREFAULT = The stack is faulted in ahead of the hot path.
+ */
+#define REALTIME_SCHED 1
+#define REALTIME_MLOCK 2
+#define REALTIME_AFFINITY 4
+#define REALTIME_PREFAULT 8
+
+/*
+ * Size of the stack that is faulted in ahead.
+ */
+#define REALTIME_STACK_PREFAULT (256 * 1024)
+
+/*
+ * Applies the realtime settings in `config` to the calling thread where permitted.
+ * Returns the realtime guarantees that are active, the memory is locked by `LLockMemory`.
+ */
+int LApplyRealtime(EConfig *config);
+
+/*
+ * Locks all memory of the process, once every thread and connection is set up.
+ * Returns REALTIME_MLOCK if it was locked, 0 otherwise.
+ */
+int LLockMemory(void);
+
+/*
+ * Prints the active realtime `guarantees`.
+ */
+void LPrintRealtime(int guarantees);
+
+#endif /* _LINUX_REALTIME_H */
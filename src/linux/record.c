@@ -0,0 +1,310 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "record.h"
+#include "axes.h"
+#include "event.h"
+#include "loop.h"
+#include "pipeline.h"
+#include "control.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+
+/*
+ * Struct that holds the state of a running recording.
+ */
+typedef struct {
+    FILE *file;
+    int status;
+    int interrupted;
+    uint32_t count;
+
+    /* Time of the previous event in microseconds. */
+    uint64_t last_us;
+} ERecorder;
+
+/*
+ * Stops the `loop` on interrupt or termination, and marks the recorder in `data` as interrupted.
+ */
+static void signal_callback(ELoop *loop, int sig, void *data)
+{
+    ERecorder *recorder = data;
+    if (sig != SIGINT && sig != SIGTERM)
+        return;
+
+    recorder->interrupted = 1;
+    LLoopStop(loop);
+}
+
+/*
+ * Appends every queued event to the recording whenever the device is readable.
+ */
+static void record_callback(ELoop *loop, int fd, void *data)
+{
+    ERecorder *recorder = data;
+    struct input_event ev[64];
+    ERecordEvent out[64];
+
+    for (;;) {
+        int rd = read(fd, ev, sizeof(ev));
+        if (rd < 0 && errno == EAGAIN)
+            return;
+        if (rd < (int) sizeof(struct input_event)) {
+            recorder->status = EXIT_FAILURE;
+            LLoopStop(loop);
+            return;
+        }
+
+        int n = rd / sizeof(struct input_event);
+        for (int i = 0; i < n; i++) {
+            uint64_t time_us = (uint64_t) ev[i].time.tv_sec * 1000000ULL + ev[i].time.tv_usec;
+            uint64_t delta_us = recorder->last_us && time_us > recorder->last_us ? time_us - recorder->last_us : 0;
+            recorder->last_us = time_us;
+
+            out[i].delta_us = delta_us > UINT32_MAX ? UINT32_MAX : (uint32_t) delta_us;
+            out[i].type = ev[i].type;
+            out[i].code = ev[i].code;
+            out[i].value = ev[i].value;
+        }
+
+        fwrite(out, sizeof(ERecordEvent), n, recorder->file);
+        recorder->count += n;
+    }
+}
+
+/*
+ * Records the events of the configured device into the file at `path` until interrupted.
+ */
+int LRecord(char *path, int verbose)
+{
+    EConfig config = CGetConfig();
+    if (config.error) {
+        ERRLN("abstouch-nux has not been set up.");
+        LOGLN("See: \x1b[;mabstouch setup");
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
+
+    /* A running input client would keep the events to itself. */
+    uint32_t paused;
+    int fd = LOpenConfiguredEvent(&config);
+    int taken = fd >= 0 && !LControlTakeEvent(config.event, fd, &paused);
+    CFreeConfig(&config);
+    if (fd < 0)
+        return EXIT_FAILURE;
+    if (!taken) {
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    ERecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.header_size = sizeof(header);
+    ioctl(fd, EVIOCGNAME(sizeof(header.name) - 1), header.name);
+
+    /* The replay starts from the axes the device had when the recording started. */
+    EAxes axes;
+    LReadAxes(fd, &axes);
+    header.abs_bits = axes.abs_bits;
+    memcpy(header.absinfo, axes.absinfo, sizeof(header.absinfo));
+
+    ERecorder recorder;
+    memset(&recorder, 0, sizeof(recorder));
+    recorder.status = EXIT_SUCCESS;
+    recorder.file = fopen(path, "wb");
+    if (recorder.file == NULL) {
+        ERRLN("Couldn't open \x1b[;m%s\x1b[1;37m for writing.", path);
+        close(fd);
+        LControlResumeEvent(paused);
+        return EXIT_FAILURE;
+    }
+    fwrite(&header, sizeof(header), 1, recorder.file);
+
+    int clock_id = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock_id);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    ELoop loop;
+    if (LLoopInit(&loop) || LLoopAddSignals(&loop, signal_callback, &recorder) < 0
+        || LLoopAdd(&loop, fd, record_callback, &recorder) < 0) {
+        ERRLN("Couldn't set up the event loop.");
+        recorder.status = EXIT_FAILURE;
+    } else {
+        LOGLNIF(verbose, "Recording \x1b[0;37m%s\x1b[1;37m, press Ctrl + C to stop.", header.name);
+        LLoopRun(&loop);
+
+        /* Only an interrupt ends the recording as asked, otherwise the device went away. */
+        if (!recorder.interrupted)
+            ERRLN("Lost the device after \x1b[0;37m%u\x1b[1;37m events, they are kept in \x1b[;m%s", recorder.count, path);
+    }
+    LLoopClose(&loop);
+    close(fd);
+    LControlResumeEvent(paused);
+
+    /* The count is only known now, the header is rewritten with it. */
+    header.count = recorder.count;
+    fseek(recorder.file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, recorder.file);
+    fclose(recorder.file);
+
+    SUCCESSLNIF(verbose && !recorder.status, "Recorded \x1b[0;37m%u\x1b[1;37m events to \x1b[;m%s\x1b[1;37m.", recorder.count, path);
+    return recorder.status;
+}
+
+/*
+ * Maps the recording at `path` into `recording`.
+ */
+int LOpenRecording(ERecording *recording, char *path)
+{
+    memset(recording, 0, sizeof(*recording));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ERRLN("Couldn't open \x1b[;m%s\x1b[1;37m.", path);
+        return EXIT_FAILURE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(ERecordHeader)) {
+        ERRLN("\x1b[;m%s\x1b[1;37m is not a recording.", path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ERRLN("Couldn't map \x1b[;m%s\x1b[1;37m.", path);
+        return EXIT_FAILURE;
+    }
+
+    const ERecordHeader *header = data;
+    if (memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) || header->version != RECORD_VERSION
+        || header->header_size < sizeof(ERecordHeader) || header->header_size > st.st_size) {
+        ERRLN("\x1b[;m%s\x1b[1;37m is not a supported recording.", path);
+        munmap(data, st.st_size);
+        return EXIT_FAILURE;
+    }
+
+    recording->header = header;
+    recording->events = (const ERecordEvent *) ((const char *) data + header->header_size);
+    recording->size = st.st_size;
+
+    /* An interrupted recording has no count, the events up to the end of the file are used. */
+    uint32_t available = (st.st_size - header->header_size) / sizeof(ERecordEvent);
+    recording->count = header->count && header->count <= available ? header->count : available;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Unmaps the `recording`.
+ */
+void LCloseRecording(ERecording *recording)
+{
+    if (recording->header != NULL)
+        munmap((void *) recording->header, recording->size);
+    recording->header = NULL;
+}
+
+/*
+ * Streams the recording at `path` to the configured output.
+ * Keeps the original timing unless `fast` is true.
+ */
+int LReplay(char *path, int fast, int verbose)
+{
+    EConfig config = CGetConfig();
+    if (config.error) {
+        ERRLN("abstouch-nux has not been set up.");
+        LOGLN("See: \x1b[;mabstouch setup");
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
+
+    ERecording recording;
+    if (LOpenRecording(&recording, path)) {
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
+    LOGLNIF(verbose, "Replaying \x1b[0;37m%u\x1b[1;37m events of \x1b[0;37m%s\x1b[1;37m.", recording.count, recording.header->name);
+
+    EOutput output;
+    if (LOpenConfiguredOutput(&output, &config, verbose)) {
+        LCloseRecording(&recording);
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
+
+    /* Slots, ranges and the starting position come from the device the recording was made on. */
+    EAxes axes;
+    axes.abs_bits = recording.header->abs_bits;
+    memcpy(axes.absinfo, recording.header->absinfo, sizeof(axes.absinfo));
+
+    EPipeline pipeline;
+    if (LPipelineInitAxes(&pipeline, &config, &axes, &output)) {
+        LCloseOutput(&output);
+        LCloseRecording(&recording);
+        CFreeConfig(&config);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t start_ns = LStatsNow(CLOCK_MONOTONIC);
+    uint64_t offset_ns = 0;
+    uint32_t frames = 0;
+    for (uint32_t i = 0; i < recording.count; i++) {
+        const ERecordEvent *record = &recording.events[i];
+        offset_ns += record->delta_us * 1000ULL;
+
+        uint64_t time_ns = fast ? LStatsNow(CLOCK_MONOTONIC) : start_ns + offset_ns;
+        struct input_event ev;
+        ev.time.tv_sec = time_ns / 1000000000ULL;
+        ev.time.tv_usec = (time_ns % 1000000000ULL) / 1000;
+        ev.type = record->type;
+        ev.code = record->code;
+        ev.value = record->value;
+
+        /* A frame that presses goes out while it is fed, so the wait is before the event that completes it. */
+        if (!fast && ev.type == EV_SYN) {
+            struct timespec ts = {.tv_sec = time_ns / 1000000000ULL, .tv_nsec = time_ns % 1000000000ULL};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+        }
+        if (!LPipelineFeed(&pipeline, &ev, 1))
+            continue;
+
+        LPipelineOutput(&pipeline);
+        frames++;
+    }
+
+    double seconds = (LStatsNow(CLOCK_MONOTONIC) - start_ns) / 1e9;
+    SUCCESSLNIF(verbose, "Replayed \x1b[0;37m%u\x1b[1;37m frames in \x1b[0;37m%.3f\x1b[1;37ms.", frames, seconds);
+
+    LPipelineClose(&pipeline);
+    LCloseOutput(&output);
+    LCloseRecording(&recording);
+    CFreeConfig(&config);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_RECORD_H
+#define _LINUX_RECORD_H
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#define RECORD_MAGIC "ATRC"
+#define RECORD_VERSION 1
+
+/*
+ * Header at the start of a recording.
+ * `abs_bits` has a bit set for every axis in `absinfo` that the device has.
+ */
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t abs_bits;
+    char name[256];
+    struct input_absinfo absinfo[ABS_CNT];
+} ERecordHeader;
+
+/*
+ * A recorded event with its time in microseconds since the previous one.
+ */
+typedef struct {
+    uint32_t delta_us;
+    uint16_t type;
+    uint16_t code;
+    int32_t value;
+} ERecordEvent;
+
+/*
+ * Struct that holds a recording mapped into memory.
+ */
+typedef struct {
+    const ERecordHeader *header;
+    const ERecordEvent *events;
+    uint32_t count;
+    size_t size;
+} ERecording;
+
+/*
+ * Records the events of the configured device into the file at `path` until interrupted.
+ */
+int LRecord(char *path, int verbose);
+
+/*
+ * Maps the recording at `path` into `recording`.
+ */
+int LOpenRecording(ERecording *recording, char *path);
+
+/*
+ * Unmaps the `recording`.
+ */
+void LCloseRecording(ERecording *recording);
+
+/*
+ * Streams the recording at `path` to the configured output.
+ * Keeps the original timing unless `fast` is true.
+ */
+int LReplay(char *path, int fast, int verbose);
+
+#endif /* _LINUX_RECORD_H */
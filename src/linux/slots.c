@@ -0,0 +1,206 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "slots.h"
+
+#include <string.h>
+#include <sys/ioctl.h>
+
+/*
+ * Slot values resynced from the device, in the order of `ESlot`.
+ */
+static const int resync_codes[] = {
+    ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y,
+    ABS_MT_PRESSURE, ABS_MT_TOUCH_MAJOR, ABS_MT_TOUCH_MINOR, ABS_MT_TOOL_TYPE
+};
+
+/*
+ * Returns the primary contact policy with the given `name` or -1 if unknown.
+ */
+int LGetSlotPolicy(char *name)
+{
+    if (!strcmp(name, "first"))
+        return SLOT_PRIMARY_FIRST;
+    else if (!strcmp(name, "recent"))
+        return SLOT_PRIMARY_RECENT;
+    else if (!strcmp(name, "pressure"))
+        return SLOT_PRIMARY_PRESSURE;
+    return -1;
+}
+
+/*
+ * Sets the `value` of the `code` in the `slot` at `index` of `slots`.
+ */
+static void set_value(ESlots *slots, int index, int code, int value)
+{
+    ESlot *slot = &slots->slots[index];
+    switch (code) {
+        case ABS_MT_TRACKING_ID:
+            /* A slot can get a new contact without being lifted in between if events were dropped. */
+            if (value >= 0 && value != slot->tracking_id)
+                slot->sequence = ++slots->sequence;
+            slot->tracking_id = value;
+            break;
+        case ABS_MT_POSITION_X:
+            slot->x = value;
+            break;
+        case ABS_MT_POSITION_Y:
+            slot->y = value;
+            break;
+        case ABS_MT_PRESSURE:
+            slot->pressure = value;
+            break;
+        case ABS_MT_TOUCH_MAJOR:
+            slot->touch_major = value;
+            break;
+        case ABS_MT_TOUCH_MINOR:
+            slot->touch_minor = value;
+            break;
+        case ABS_MT_TOOL_TYPE:
+            slot->tool_type = value;
+            break;
+        default:
+            return;
+    }
+
+    slots->pending |= 1u << index;
+}
+
+/*
+ * Initializes the `slots` with the multitouch axes in `axes`, resyncing them from `fd`.
+ * `fd` can be negative if there is no device to resync from.
+ * Without a slot axis in `axes`, the slots are found from the events.
+ */
+void LSlotsInit(ESlots *slots, int fd, const EAxes *axes)
+{
+    memset(slots, 0, sizeof(*slots));
+    slots->fd = fd;
+    slots->primary = -1;
+    for (int i = 0; i < SLOTS_MAX; i++)
+        slots->slots[i].tracking_id = -1;
+
+    if (!LHasAxis(axes, ABS_MT_SLOT))
+        return;
+
+    const struct input_absinfo *absinfo = &axes->absinfo[ABS_MT_SLOT];
+    slots->multitouch = 1;
+    slots->count = absinfo->maximum + 1 < SLOTS_MAX ? absinfo->maximum + 1 : SLOTS_MAX;
+    slots->current = absinfo->value >= 0 && absinfo->value < slots->count ? absinfo->value : 0;
+    slots->pressure = LHasAxis(axes, ABS_MT_PRESSURE);
+    LSlotsResync(slots);
+    LSlotsCommit(slots);
+}
+
+/*
+ * Resyncs every slot from the device using `EVIOCGMTSLOTS`.
+ */
+int LSlotsResync(ESlots *slots)
+{
+    if (slots->fd < 0 || !slots->multitouch)
+        return -1;
+
+    struct {
+        uint32_t code;
+        int32_t values[SLOTS_MAX];
+    } request;
+    for (int i = 0; i < (int) (sizeof(resync_codes) / sizeof(resync_codes[0])); i++) {
+        request.code = resync_codes[i];
+        if (ioctl(slots->fd, EVIOCGMTSLOTS(sizeof(request)), &request) < 0)
+            continue;
+
+        for (int j = 0; j < slots->count; j++)
+            set_value(slots, j, resync_codes[i], request.values[j]);
+    }
+
+    struct input_absinfo absinfo;
+    if (!ioctl(slots->fd, EVIOCGABS(ABS_MT_SLOT), &absinfo))
+        slots->current = absinfo.value;
+    return 0;
+}
+
+/*
+ * Pushes the multitouch `ev` to the `slots`.
+ * Returns true if the event was a multitouch event.
+ */
+int LSlotsPush(ESlots *slots, const struct input_event *ev)
+{
+    if (ev->type != EV_ABS || ev->code < ABS_MT_SLOT || ev->code > ABS_MT_TOOL_Y)
+        return 0;
+
+    /* Without a device the slots are only known once a recording shows them. */
+    if (!slots->multitouch) {
+        if (slots->fd >= 0 || (ev->code != ABS_MT_SLOT && ev->code != ABS_MT_TRACKING_ID))
+            return 1;
+        slots->multitouch = 1;
+        slots->count = SLOTS_MAX;
+    }
+
+    if (ev->code == ABS_MT_SLOT)
+        slots->current = ev->value;
+    else if (slots->current >= 0 && slots->current < slots->count) {
+        slots->pressure |= ev->code == ABS_MT_PRESSURE;
+        set_value(slots, slots->current, ev->code, ev->value);
+    }
+    return 1;
+}
+
+/*
+ * Completes the frame of the `slots` and chooses its primary contact out of the ones that aren't rejected.
+ * Returns the primary slot or -1 if nothing usable touches.
+ */
+int LSlotsCommit(ESlots *slots)
+{
+    slots->dirty = slots->pending;
+    slots->pending = 0;
+
+    slots->active = 0;
+    for (int i = 0; i < slots->count; i++) {
+        if (slots->slots[i].tracking_id >= 0)
+            slots->active |= 1u << i;
+    }
+
+    /* The primary contact only changes on a tie if it was lifted. */
+    uint32_t usable = slots->active & ~slots->rejected;
+    int primary = slots->primary >= 0 && (usable & (1u << slots->primary)) ? slots->primary : -1;
+    for (int i = 0; i < slots->count; i++) {
+        if (!(usable & (1u << i)) || i == primary)
+            continue;
+        if (primary < 0) {
+            primary = i;
+            continue;
+        }
+
+        ESlot *slot = &slots->slots[i], *best = &slots->slots[primary];
+        switch (slots->policy) {
+            case SLOT_PRIMARY_FIRST:
+                if (slot->sequence < best->sequence)
+                    primary = i;
+                break;
+            case SLOT_PRIMARY_RECENT:
+                if (slot->sequence > best->sequence)
+                    primary = i;
+                break;
+            case SLOT_PRIMARY_PRESSURE:
+                if (slot->pressure > best->pressure)
+                    primary = i;
+                break;
+        }
+    }
+
+    slots->primary = primary;
+    return primary;
+}
@@ -0,0 +1,115 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_SLOTS_H
+#define _LINUX_SLOTS_H
+
+#include "axes.h"
+
+#include <stdint.h>
+#include <linux/input.h>
+
+/*
+ * Maximum count of multitouch slots that are tracked, the rest of them are ignored.
+ */
+#define SLOTS_MAX 16
+
+/*
+ * Primary contact policies.
+ * - SLOT_PRIMARY_FIRST = The contact that went down first, until it is lifted.
+ * - SLOT_PRIMARY_RECENT = The contact that went down last.
+ * - SLOT_PRIMARY_PRESSURE = The contact that presses the hardest.
+ */
+#define SLOT_PRIMARY_FIRST 0
+#define SLOT_PRIMARY_RECENT 1
+#define SLOT_PRIMARY_PRESSURE 2
+
+/*
+ * Struct that holds the state of one multitouch slot.
+ * `tracking_id` is -1 if there is no contact in the slot.
+ */
+typedef struct {
+    int tracking_id;
+    int x;
+    int y;
+    int pressure;
+    int touch_major;
+    int touch_minor;
+    int tool_type;
+
+    /* Order in which the contact went down. */
+    uint64_t sequence;
+} ESlot;
+
+/*
+ * Struct that decodes the multitouch protocol B into the state of every slot.
+ */
+typedef struct {
+    int fd;
+    int policy;
+
+    /* Count of slots the device has and the one the events are for. */
+    int count;
+    int current;
+
+    /* True if the device is multitouch, and if it reports the pressure of each contact. */
+    int multitouch;
+    int pressure;
+
+    ESlot slots[SLOTS_MAX];
+    uint64_t sequence;
+
+    /* Slots changed since the last frame, and in the last frame. */
+    uint32_t pending;
+    uint32_t dirty;
+
+    /* Slots with a contact, the ones that can't be the primary one and the primary one, -1 if there is none. */
+    uint32_t active;
+    uint32_t rejected;
+    int primary;
+} ESlots;
+
+/*
+ * Returns the primary contact policy with the given `name` or -1 if unknown.
+ */
+int LGetSlotPolicy(char *name);
+
+/*
+ * Initializes the `slots` with the multitouch axes in `axes`, resyncing them from `fd`.
+ * `fd` can be negative if there is no device to resync from.
+ * Without a slot axis in `axes`, the slots are found from the events.
+ */
+void LSlotsInit(ESlots *slots, int fd, const EAxes *axes);
+
+/*
+ * Resyncs every slot from the device using `EVIOCGMTSLOTS`.
+ */
+int LSlotsResync(ESlots *slots);
+
+/*
+ * Pushes the multitouch `ev` to the `slots`.
+ * Returns true if the event was a multitouch event.
+ */
+int LSlotsPush(ESlots *slots, const struct input_event *ev);
+
+/*
+ * Completes the frame of the `slots` and chooses its primary contact out of the ones that aren't rejected.
+ * Returns the primary slot or -1 if nothing usable touches.
+ */
+int LSlotsCommit(ESlots *slots);
+
+#endif /* _LINUX_SLOTS_H */
@@ -0,0 +1,250 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "stats.h"
+#include "realtime.h"
+#include "control.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Returns the histogram bucket of `value`.
+ */
+static int bucket_index(uint64_t value)
+{
+    if (value >= (1ULL << STATS_MAX_BITS))
+        value = (1ULL << STATS_MAX_BITS) - 1;
+    if (value < (1ULL << STATS_SUB_BITS))
+        return (int) value;
+
+    int shift = 63 - __builtin_clzll(value) - STATS_SUB_BITS + 1;
+    return (shift << (STATS_SUB_BITS - 1)) + (int) (value >> shift);
+}
+
+/*
+ * Returns the highest value that falls into the histogram bucket `index`.
+ */
+static uint64_t bucket_value(int index)
+{
+    if (index < (1 << STATS_SUB_BITS))
+        return index;
+
+    int shift = (index >> (STATS_SUB_BITS - 1)) - 1;
+    uint64_t base = index - ((uint64_t) shift << (STATS_SUB_BITS - 1));
+    return ((base + 1) << shift) - 1;
+}
+
+/*
+ * Returns the current time of `clock` in nanoseconds.
+ */
+uint64_t LStatsNow(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Maps the statistics of the device configured in `profile` for the current user.
+ * The input client passes true for `create` to create and reset them.
+ */
+EStats *LOpenStats(char *profile, int create)
+{
+    char name[NAME_MAX];
+    if (!strcmp(profile, "abstouch-nux"))
+        snprintf(name, sizeof(name), "%s%d", STATS_SHM_PREFIX, getuid());
+    else
+        snprintf(name, sizeof(name), "%s%d-%s", STATS_SHM_PREFIX, getuid(), profile);
+
+    int fd = shm_open(name, create ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+    if (fd < 0)
+        return NULL;
+    if (create && ftruncate(fd, sizeof(EStats)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(EStats)) {
+        close(fd);
+        return NULL;
+    }
+
+    EStats *stats = mmap(NULL, sizeof(EStats), create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (stats == MAP_FAILED)
+        return NULL;
+
+    if (create) {
+        memset(stats, 0, sizeof(EStats));
+        stats->magic = STATS_MAGIC;
+        stats->version = STATS_VERSION;
+        atomic_store(&stats->pid, getpid());
+        atomic_store(&stats->start_ns, LStatsNow(CLOCK_MONOTONIC));
+        atomic_store(&stats->running, 1);
+    } else if (stats->magic != STATS_MAGIC || stats->version != STATS_VERSION) {
+        munmap(stats, sizeof(EStats));
+        return NULL;
+    }
+
+    return stats;
+}
+
+/*
+ * Marks the statistics as stopped and unmaps them.
+ */
+void LCloseStats(EStats *stats)
+{
+    if (stats == NULL)
+        return;
+
+    /* The segment is kept so the last run can still be inspected. */
+    atomic_store(&stats->stop_ns, LStatsNow(CLOCK_MONOTONIC));
+    atomic_store(&stats->running, 0);
+    munmap(stats, sizeof(EStats));
+}
+
+/*
+ * Records `frames` assembled frames of which the latest reached the output after `latency_ns`.
+ */
+void LStatsRecord(EStats *stats, uint64_t latency_ns, int frames)
+{
+    if (stats == NULL)
+        return;
+
+    /* There is a single writer, relaxed ordering is enough for consistent counters. */
+    atomic_fetch_add_explicit(&stats->frames, frames, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->coalesced, frames - 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->outputs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->total_ns, latency_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->buckets[bucket_index(latency_ns)], 1, memory_order_relaxed);
+    if (latency_ns > atomic_load_explicit(&stats->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&stats->max_ns, latency_ns, memory_order_relaxed);
+}
+
+/*
+ * Records that the device was reattached `recovery_ns` after it was lost.
+ */
+void LStatsReattach(EStats *stats, uint64_t recovery_ns)
+{
+    if (stats == NULL)
+        return;
+
+    atomic_fetch_add_explicit(&stats->reattaches, 1, memory_order_relaxed);
+    atomic_store_explicit(&stats->recovery_ns, recovery_ns, memory_order_relaxed);
+    if (recovery_ns > atomic_load_explicit(&stats->max_recovery_ns, memory_order_relaxed))
+        atomic_store_explicit(&stats->max_recovery_ns, recovery_ns, memory_order_relaxed);
+}
+
+/*
+ * Returns the latency in nanoseconds under which `percentile` percent of the outputs are.
+ */
+uint64_t LStatsPercentile(EStats *stats, double percentile)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++)
+        total += atomic_load_explicit(&stats->buckets[i], memory_order_relaxed);
+    if (!total)
+        return 0;
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t max = atomic_load_explicit(&stats->max_ns, memory_order_relaxed);
+    uint64_t count = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        count += atomic_load_explicit(&stats->buckets[i], memory_order_relaxed);
+        if (count >= rank)
+            return bucket_value(i) < max ? bucket_value(i) : max;
+    }
+
+    return max;
+}
+
+/*
+ * Prints the statistics.
+ */
+void LPrintStats(EStats *stats)
+{
+    uint64_t frames = atomic_load(&stats->frames);
+    uint64_t coalesced = atomic_load(&stats->coalesced);
+    uint64_t outputs = atomic_load(&stats->outputs);
+    uint64_t end = atomic_load(&stats->running) ? LStatsNow(CLOCK_MONOTONIC) : atomic_load(&stats->stop_ns);
+    double seconds = (end - atomic_load(&stats->start_ns)) / 1e9;
+
+    LOGLN("Client \x1b[0;37m%d\x1b[1;37m (%s), up for \x1b[0;37m%.1f\x1b[1;37ms.",
+        atomic_load(&stats->pid), atomic_load(&stats->running) ? "running" : "stopped", seconds);
+    LOGLN("Frames => \x1b[0;37m%lu\x1b[1;37m, coalesced => \x1b[0;37m%lu\x1b[1;37m, outputs => \x1b[0;37m%lu",
+        (unsigned long) frames, (unsigned long) coalesced, (unsigned long) outputs);
+    LOGLN("Frames per second => \x1b[0;37m%.1f", seconds > 0 ? frames / seconds : 0.0);
+    if (atomic_load(&stats->realtime))
+        LPrintRealtime(atomic_load(&stats->realtime));
+    if (atomic_load(&stats->reattaches))
+        LOGLN("Reattached => \x1b[0;37m%lu\x1b[1;37m times, last after \x1b[0;37m%.1f\x1b[1;37mms, max \x1b[0;37m%.1f\x1b[1;37mms",
+            (unsigned long) atomic_load(&stats->reattaches),
+            atomic_load(&stats->recovery_ns) / 1e6, atomic_load(&stats->max_recovery_ns) / 1e6);
+    if (!outputs)
+        return;
+
+    LOGLN("Latency => mean \x1b[0;37m%.1f\x1b[1;37mus, p50 \x1b[0;37m%.1f\x1b[1;37mus, p99 \x1b[0;37m%.1f\x1b[1;37mus, p99.9 \x1b[0;37m%.1f\x1b[1;37mus, max \x1b[0;37m%.1f\x1b[1;37mus",
+        atomic_load(&stats->total_ns) / (double) outputs / 1e3,
+        LStatsPercentile(stats, 50) / 1e3, LStatsPercentile(stats, 99) / 1e3,
+        LStatsPercentile(stats, 99.9) / 1e3, atomic_load(&stats->max_ns) / 1e3);
+}
+
+/*
+ * Prints the statistics of every device of the running input client, or of the last one.
+ */
+int LShowStats(void)
+{
+    /* A running client answers with a snapshot, the shared memory is only read when it has exited. */
+    EControlResponse response;
+    EStats snapshot;
+    int shown = 0;
+    for (int i = 0, devices = 1; i < devices; i++) {
+        if (LControlSend(CONTROL_STATS, NULL, i, &response, &snapshot) || !response.has_stats)
+            continue;
+
+        devices = response.devices;
+        if (devices > 1)
+            PRINTLN("---===%s===---", response.profile);
+        LPrintStats(&snapshot);
+        shown = 1;
+    }
+    if (shown)
+        return EXIT_SUCCESS;
+
+    EStats *stats = LOpenStats("abstouch-nux", 0);
+    if (stats == NULL) {
+        ERRLN("No statistics found.");
+        LOGLN("See: \x1b[;mabstouch start");
+        return EXIT_FAILURE;
+    }
+
+    LPrintStats(stats);
+    munmap(stats, sizeof(EStats));
+    return EXIT_SUCCESS;
+}
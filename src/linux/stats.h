@@ -0,0 +1,111 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_STATS_H
+#define _LINUX_STATS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define STATS_SHM_PREFIX "/abstouch-nux-stats-"
+#define STATS_MAGIC 0x41425354
+#define STATS_VERSION 3
+
+/*
+ * The histogram keeps 2^(STATS_SUB_BITS - 1) buckets for each power of two,
+ * which is a relative error of about 3% from 64ns up to STATS_MAX_BITS bits of nanoseconds.
+ */
+#define STATS_SUB_BITS 6
+#define STATS_MAX_BITS 40
+#define STATS_BUCKETS ((STATS_MAX_BITS - STATS_SUB_BITS + 3) << (STATS_SUB_BITS - 1))
+
+/*
+ * Struct that holds the latency statistics of the input client.
+ * It lives in shared memory and is only written by the input client,
+ * so readers can take a snapshot at any time without locking.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+
+    _Atomic int32_t pid;
+    _Atomic int32_t running;
+    _Atomic uint64_t start_ns;
+    _Atomic uint64_t stop_ns;
+
+    /* Realtime guarantees the client runs with, see realtime.h. */
+    _Atomic int32_t realtime;
+
+    /* Times the device came back after it was lost, and how long that took. */
+    _Atomic uint64_t reattaches;
+    _Atomic uint64_t recovery_ns;
+    _Atomic uint64_t max_recovery_ns;
+
+    /* Frames assembled, and how many of them were skipped for a newer one. */
+    _Atomic uint64_t frames;
+    _Atomic uint64_t coalesced;
+
+    /* Frames that reached the output and their latency from the kernel timestamp. */
+    _Atomic uint64_t outputs;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[STATS_BUCKETS];
+} EStats;
+
+/*
+ * Returns the current time of `clock` in nanoseconds.
+ */
+uint64_t LStatsNow(clockid_t clock);
+
+/*
+ * Maps the statistics of the device configured in `profile` for the current user.
+ * The input client passes true for `create` to create and reset them.
+ */
+EStats *LOpenStats(char *profile, int create);
+
+/*
+ * Marks the statistics as stopped and unmaps them.
+ */
+void LCloseStats(EStats *stats);
+
+/*
+ * Records `frames` assembled frames of which the latest reached the output after `latency_ns`.
+ */
+void LStatsRecord(EStats *stats, uint64_t latency_ns, int frames);
+
+/*
+ * Records that the device was reattached `recovery_ns` after it was lost.
+ */
+void LStatsReattach(EStats *stats, uint64_t recovery_ns);
+
+/*
+ * Returns the latency in nanoseconds under which `percentile` percent of the outputs are.
+ */
+uint64_t LStatsPercentile(EStats *stats, double percentile);
+
+/*
+ * Prints the statistics.
+ */
+void LPrintStats(EStats *stats);
+
+/*
+ * Prints the statistics of every device of the running input client, or of the last one.
+ */
+int LShowStats(void);
+
+#endif /* _LINUX_STATS_H */
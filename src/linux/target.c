@@ -0,0 +1,371 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "target.h"
+#include "../print.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/Xrandr.h>
+
+/*
+ * The X error handler that was installed before the one of the window targets.
+ */
+static int (*previous_handler)(Display *, XErrorEvent *) = NULL;
+
+/*
+ * Ignores the errors about followed windows that were destroyed in the meantime.
+ */
+static int window_error_handler(Display *display, XErrorEvent *error)
+{
+    if (error->error_code == BadWindow || error->error_code == BadDrawable)
+        return 0;
+    return previous_handler != NULL ? previous_handler(display, error) : 0;
+}
+
+/*
+ * Parses the target `spec` into `target`.
+ */
+static int parse_target(ETarget *target, char *spec)
+{
+    char name[256];
+    if (spec == NULL || spec[0] == '\0' || !strcmp(spec, "root"))
+        target->type = TARGET_ROOT;
+    else if (sscanf(spec, "output:%255s", name) == 1) {
+        target->type = TARGET_OUTPUT;
+        strcpy(target->name, name);
+    } else if (sscanf(spec, "crtc:%d", &target->crtc) == 1 && target->crtc >= 0)
+        target->type = TARGET_CRTC;
+    else if (sscanf(spec, "rect:%d,%d,%d,%d", &target->rect.x, &target->rect.y,
+        &target->rect.width, &target->rect.height) == 4 && target->rect.width > 0 && target->rect.height > 0)
+        target->type = TARGET_RECT;
+    else if (!strcmp(spec, "window:active")) {
+        target->type = TARGET_WINDOW;
+        target->match = TARGET_MATCH_ACTIVE;
+    } else if (sscanf(spec, "window:class:%255[^\n]", name) == 1) {
+        target->type = TARGET_WINDOW;
+        target->match = TARGET_MATCH_CLASS;
+        strcpy(target->name, name);
+    } else if (sscanf(spec, "window:pid:%ld", &target->pid) == 1) {
+        target->type = TARGET_WINDOW;
+        target->match = TARGET_MATCH_PID;
+    } else if (sscanf(spec, "window:name:%255[^\n]", name) == 1) {
+        target->type = TARGET_WINDOW;
+        target->match = TARGET_MATCH_NAME;
+        strcpy(target->name, name);
+    } else
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Resolves the area of the XRandR output or CRTC of `target`.
+ */
+static int resolve_randr(ETarget *target)
+{
+    XRRScreenResources *resources = XRRGetScreenResourcesCurrent(target->display, target->root);
+    if (resources == NULL)
+        return EXIT_FAILURE;
+
+    RRCrtc crtc = None;
+    if (target->type == TARGET_CRTC && target->crtc < resources->ncrtc)
+        crtc = resources->crtcs[target->crtc];
+    for (int i = 0; target->type == TARGET_OUTPUT && i < resources->noutput; i++) {
+        XRROutputInfo *info = XRRGetOutputInfo(target->display, resources, resources->outputs[i]);
+        if (info == NULL)
+            continue;
+        if (!strcmp(info->name, target->name))
+            crtc = info->crtc;
+        XRRFreeOutputInfo(info);
+    }
+
+    int result = EXIT_FAILURE;
+    XRRCrtcInfo *info = crtc != None ? XRRGetCrtcInfo(target->display, resources, crtc) : NULL;
+    if (info != NULL && info->width > 0 && info->height > 0) {
+        target->rect = (ERect) {info->x, info->y, info->width, info->height};
+        result = EXIT_SUCCESS;
+    }
+
+    if (info != NULL)
+        XRRFreeCrtcInfo(info);
+    XRRFreeScreenResources(resources);
+    return result;
+}
+
+/*
+ * Returns the `property` of `type` on `window` and sets `count`, or NULL. Free with XFree.
+ */
+static unsigned char *get_property(ETarget *target, Window window, Atom property, Atom type, unsigned long *count)
+{
+    Atom actual_type;
+    int format;
+    unsigned long after;
+    unsigned char *data = NULL;
+    *count = 0;
+    if (XGetWindowProperty(target->display, window, property, 0, 65536, False, type,
+        &actual_type, &format, count, &after, &data) != Success || actual_type != type) {
+        if (data != NULL)
+            XFree(data);
+        *count = 0;
+        return NULL;
+    }
+
+    return data;
+}
+
+/*
+ * Returns true if `window` is the window `target` looks for.
+ */
+static int window_matches(ETarget *target, Window window)
+{
+    unsigned long count;
+    int matches = 0;
+    if (target->match == TARGET_MATCH_CLASS) {
+        XClassHint hint;
+        if (XGetClassHint(target->display, window, &hint)) {
+            matches = !strcmp(hint.res_class, target->name) || !strcmp(hint.res_name, target->name);
+            XFree(hint.res_name);
+            XFree(hint.res_class);
+        }
+    } else if (target->match == TARGET_MATCH_PID) {
+        unsigned char *pid = get_property(target, window, target->wm_pid, XA_CARDINAL, &count);
+        matches = pid != NULL && count > 0 && *(long *) pid == target->pid;
+        if (pid != NULL)
+            XFree(pid);
+    } else if (target->match == TARGET_MATCH_NAME) {
+        unsigned char *name = get_property(target, window, target->wm_name, target->utf8_string, &count);
+        if (name == NULL)
+            name = get_property(target, window, XA_WM_NAME, XA_STRING, &count);
+        matches = name != NULL && strstr((char *) name, target->name) != NULL;
+        if (name != NULL)
+            XFree(name);
+    }
+
+    return matches;
+}
+
+/*
+ * Returns the window `target` looks for, or None if there is none.
+ */
+static Window find_window(ETarget *target)
+{
+    unsigned long count;
+    Window found = None;
+    if (target->match == TARGET_MATCH_ACTIVE) {
+        unsigned char *active = get_property(target, target->root, target->active_window, XA_WINDOW, &count);
+        if (active != NULL && count > 0)
+            found = *(Window *) active;
+        if (active != NULL)
+            XFree(active);
+        return found;
+    }
+
+    unsigned char *list = get_property(target, target->root, target->client_list, XA_WINDOW, &count);
+    for (unsigned long i = 0; list != NULL && i < count && found == None; i++) {
+        if (window_matches(target, ((Window *) list)[i]))
+            found = ((Window *) list)[i];
+    }
+    if (list != NULL)
+        XFree(list);
+    return found;
+}
+
+/*
+ * Queries the area of the followed window of `target` in root pixels.
+ * Only called when the window changes, never per frame.
+ */
+static int query_window(ETarget *target)
+{
+    XWindowAttributes attributes;
+    int x, y;
+    Window child;
+    if (!XGetWindowAttributes(target->display, target->window, &attributes)
+        || !XTranslateCoordinates(target->display, target->window, target->root, 0, 0, &x, &y, &child)
+        || attributes.width < 1 || attributes.height < 1)
+        return EXIT_FAILURE;
+
+    target->rect = (ERect) {x, y, attributes.width, attributes.height};
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Follows the window `target` looks for, keeping the last area while there is none.
+ */
+static void follow_window(ETarget *target)
+{
+    Window window = find_window(target);
+    if (window != target->window) {
+        if (target->window != None)
+            XSelectInput(target->display, target->window, NoEventMask);
+        target->window = window;
+        if (window != None)
+            XSelectInput(target->display, window, StructureNotifyMask);
+    }
+
+    if (target->window != None)
+        query_window(target);
+}
+
+/*
+ * Updates the area of a window `target` from the X `event`.
+ */
+static void handle_window_event(ETarget *target, XEvent *event)
+{
+    if (event->type == PropertyNotify && event->xproperty.window == target->root) {
+        Atom atom = event->xproperty.atom;
+        if (atom == (target->match == TARGET_MATCH_ACTIVE ? target->active_window : target->client_list))
+            follow_window(target);
+    } else if (event->type == ConfigureNotify && event->xconfigure.window == target->window) {
+        /* Window managers send synthetic events in root coordinates, real ones are relative to the frame. */
+        if (event->xconfigure.send_event)
+            target->rect = (ERect) {event->xconfigure.x, event->xconfigure.y,
+                event->xconfigure.width, event->xconfigure.height};
+        else
+            query_window(target);
+    } else if (event->type == MapNotify && event->xmap.window == target->window)
+        query_window(target);
+    else if (event->type == DestroyNotify && event->xdestroywindow.window == target->window) {
+        target->window = None;
+        follow_window(target);
+    }
+}
+
+/*
+ * Resolves the geometry of `target`.
+ */
+static int resolve_target(ETarget *target)
+{
+    switch (target->type) {
+        case TARGET_ROOT:
+            target->rect = (ERect) {0, 0, target->root_width, target->root_height};
+            return EXIT_SUCCESS;
+        case TARGET_RECT:
+            return EXIT_SUCCESS;
+        case TARGET_OUTPUT:
+        case TARGET_CRTC:
+            if (target->display == NULL || !target->randr)
+                return EXIT_FAILURE;
+            return resolve_randr(target);
+        case TARGET_WINDOW:
+            /* The whole root is used until the window shows up. */
+            if (target->display == NULL)
+                return EXIT_FAILURE;
+            if (target->window == None)
+                target->rect = (ERect) {0, 0, target->root_width, target->root_height};
+            follow_window(target);
+            return EXIT_SUCCESS;
+    }
+
+    return EXIT_FAILURE;
+}
+
+/*
+ * Parses the target `spec` into `target` and resolves its geometry on `display`.
+ * `display` can be NULL, then only `root` and `rect:` targets of a `width`x`height` root are possible.
+ */
+int LOpenTarget(ETarget *target, char *spec, Display *display, Window root, int width, int height)
+{
+    memset(target, 0, sizeof(*target));
+    snprintf(target->spec, sizeof(target->spec), "%s", spec != NULL ? spec : "root");
+    target->display = display;
+    target->root = root;
+    target->root_width = width;
+    target->root_height = height;
+    if (parse_target(target, spec)) {
+        ERRLN("Unknown target: \x1b[;m%s", target->spec);
+        return EXIT_FAILURE;
+    }
+
+    /* Layout changes arrive on the X connection the client already polls. */
+    int error_base;
+    if (display != NULL && XRRQueryExtension(display, &target->randr_event_base, &error_base)) {
+        target->randr = 1;
+        XRRSelectInput(display, root, RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    }
+
+    if (display != NULL && target->type == TARGET_WINDOW) {
+        target->active_window = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+        target->client_list = XInternAtom(display, "_NET_CLIENT_LIST", False);
+        target->wm_pid = XInternAtom(display, "_NET_WM_PID", False);
+        target->wm_name = XInternAtom(display, "_NET_WM_NAME", False);
+        target->utf8_string = XInternAtom(display, "UTF8_STRING", False);
+        if (previous_handler == NULL)
+            previous_handler = XSetErrorHandler(window_error_handler);
+        XSelectInput(display, root, PropertyChangeMask);
+    }
+
+    if (resolve_target(target)) {
+        ERRLN("Couldn't find the target \x1b[;m%s\x1b[1;37m.", target->spec);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Updates the geometry of `target` from the X `event`.
+ * Windows are followed through `ConfigureNotify` and `PropertyNotify`, so there are no per-frame queries.
+ * Returns true if the geometry has changed.
+ */
+int LTargetHandleEvent(ETarget *target, XEvent *event)
+{
+    ERect rect = target->rect;
+    int root_width = target->root_width, root_height = target->root_height;
+
+    if (target->randr && event->type == target->randr_event_base + RRScreenChangeNotify) {
+        XRRUpdateConfiguration(event);
+        XRRScreenChangeNotifyEvent *change = (XRRScreenChangeNotifyEvent *) event;
+        if (change->root == target->root) {
+            /* The reported size is before rotation. */
+            int rotated = change->rotation & (RR_Rotate_90 | RR_Rotate_270);
+            target->root_width = rotated ? change->height : change->width;
+            target->root_height = rotated ? change->width : change->height;
+            if (target->type != TARGET_WINDOW)
+                resolve_target(target);
+        }
+    } else if (target->randr && event->type == target->randr_event_base + RRNotify) {
+        /* An output that is switched off keeps its last area until it comes back. */
+        if (target->type == TARGET_OUTPUT || target->type == TARGET_CRTC)
+            resolve_target(target);
+    } else if (target->type == TARGET_WINDOW)
+        handle_window_event(target, event);
+
+    return memcmp(&rect, &target->rect, sizeof(rect))
+        || root_width != target->root_width || root_height != target->root_height;
+}
+
+/*
+ * Returns the area of `target` scaled to an output of `width`x`height`.
+ */
+ERect LTargetRect(ETarget *target, int width, int height)
+{
+    if (width == target->root_width && height == target->root_height)
+        return target->rect;
+
+    /* Outputs without a display, like the one of the benchmark, have a size of their own. */
+    ERect rect;
+    rect.x = (int) ((int64_t) target->rect.x * width / target->root_width);
+    rect.y = (int) ((int64_t) target->rect.y * height / target->root_height);
+    rect.width = (int) ((int64_t) target->rect.width * width / target->root_width);
+    rect.height = (int) ((int64_t) target->rect.height * height / target->root_height);
+    return rect;
+}
@@ -0,0 +1,100 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_TARGET_H
+#define _LINUX_TARGET_H
+
+#include <X11/Xlib.h>
+
+#include "../transform.h"
+
+/*
+ * Mapping target types.
+ * - TARGET_ROOT = The whole root window, `root`.
+ * - TARGET_OUTPUT = The area of a named XRandR output, `output:<name>`.
+ * - TARGET_CRTC = The area of an XRandR CRTC by index, `crtc:<n>`.
+ * - TARGET_RECT = A fixed rectangle in root pixels, `rect:<x>,<y>,<width>,<height>`.
+ * - TARGET_WINDOW = A window, `window:active`, `window:class:<class>`, `window:pid:<pid>` or `window:name:<name>`.
+ */
+#define TARGET_ROOT 0
+#define TARGET_OUTPUT 1
+#define TARGET_CRTC 2
+#define TARGET_RECT 3
+#define TARGET_WINDOW 4
+
+/*
+ * How the window of a window target is found.
+ * - TARGET_MATCH_ACTIVE = The focused window from `_NET_ACTIVE_WINDOW`.
+ * - TARGET_MATCH_CLASS = The first window in `_NET_CLIENT_LIST` with the `WM_CLASS` class or instance.
+ * - TARGET_MATCH_PID = The first window in `_NET_CLIENT_LIST` with the `_NET_WM_PID`.
+ * - TARGET_MATCH_NAME = The first window in `_NET_CLIENT_LIST` with a title that contains the name.
+ */
+#define TARGET_MATCH_ACTIVE 0
+#define TARGET_MATCH_CLASS 1
+#define TARGET_MATCH_PID 2
+#define TARGET_MATCH_NAME 3
+
+/*
+ * Struct that holds the area the touchpad is mapped to.
+ * The geometry is cached and only resolved again when X reports a layout change.
+ */
+typedef struct {
+    int type;
+    char spec[256];
+    char name[256];
+    int crtc;
+    int match;
+    long pid;
+
+    /* Current area and the size of the root window it is in, in root pixels. */
+    ERect rect;
+    int root_width;
+    int root_height;
+
+    Display *display;
+    Window root;
+    int randr;
+    int randr_event_base;
+
+    /* The followed window and the atoms used to find it. */
+    Window window;
+    Atom active_window;
+    Atom client_list;
+    Atom wm_pid;
+    Atom wm_name;
+    Atom utf8_string;
+} ETarget;
+
+/*
+ * Parses the target `spec` into `target` and resolves its geometry on `display`.
+ * `display` can be NULL, then only `root` and `rect:` targets of a `width`x`height` root are possible.
+ */
+int LOpenTarget(ETarget *target, char *spec, Display *display, Window root, int width, int height);
+
+/*
+ * Updates the geometry of `target` from the X `event`.
+ * Windows are followed through `ConfigureNotify` and `PropertyNotify`, so there are no per-frame queries.
+ * Returns true if the geometry has changed.
+ */
+int LTargetHandleEvent(ETarget *target, XEvent *event);
+
+/*
+ * Returns the area of `target` scaled to an output of `width`x`height`.
+ */
+ERect LTargetRect(ETarget *target, int width, int height);
+
+#endif /* _LINUX_TARGET_H */
@@ -0,0 +1,330 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#include "visual.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/ioctl.h>
+
+#include <linux/input.h>
+
+/*
+ * Samples a cell needs to be drawn as covered enough.
+ */
+#define VISUAL_MANY_SAMPLES 8
+
+/*
+ * Drawn glyphs of the cells, two characters each.
+ */
+static const char *glyphs[] = {
+    "  ",
+    "\x1b[0;37m. ",
+    "\x1b[0;32m::",
+    "\x1b[1;32m##",
+    "\x1b[1;31m**"
+};
+
+/*
+ * Appends the formatted string to the frame buffer of `visual`, truncating it if it is full.
+ */
+static void append(EVisual *visual, const char *fmt, ...)
+{
+    size_t left = VISUAL_BUFFER_SIZE - visual->length;
+    if (left <= 1)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(visual->buffer + visual->length, left, fmt, args);
+    va_end(args);
+    if (len > 0)
+        visual->length += (size_t) len < left ? (size_t) len : left - 1;
+}
+
+/*
+ * Writes the frame buffer of `visual` to the terminal with a single write and empties it.
+ */
+static int flush(EVisual *visual)
+{
+    /* Anything printed before has to be on the terminal before the frame. */
+    fflush(stdout);
+
+    size_t written = 0;
+    while (written < visual->length) {
+        ssize_t wr = write(STDOUT_FILENO, visual->buffer + written, visual->length - written);
+        if (wr < 0 && errno == EINTR)
+            continue;
+        if (wr <= 0)
+            break;
+        written += wr;
+    }
+
+    int status = written == visual->length ? EXIT_SUCCESS : EXIT_FAILURE;
+    visual->length = 0;
+    return status;
+}
+
+/*
+ * Returns the bin of `value` in `min` - `max` split into `count` bins.
+ */
+static int bin(int value, int min, int max, int count)
+{
+    if (value <= min)
+        return 0;
+    if (value >= max)
+        return count - 1;
+    return (int) ((int64_t) (value - min) * count / ((int64_t) max - min + 1));
+}
+
+/*
+ * Reads the range of the `code` axis of the event `fd` into `min` and `max`, and its resolution.
+ */
+static int probe_axis(int fd, int code, int *min, int *max, int *resolution)
+{
+    struct input_absinfo absinfo;
+    if (ioctl(fd, EVIOCGABS(code), &absinfo) || absinfo.maximum <= absinfo.minimum)
+        return EXIT_FAILURE;
+
+    *min = absinfo.minimum;
+    *max = absinfo.maximum;
+    *resolution = absinfo.resolution;
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Sizes the box of `visual` to the terminal, keeping the aspect ratio of the device.
+ * Returns true if the size of the terminal changed since the last call.
+ */
+static int layout(EVisual *visual)
+{
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) || ws.ws_col == 0 || ws.ws_row == 0) {
+        ws.ws_col = 80;
+        ws.ws_row = 24;
+    }
+    if (ws.ws_col == visual->term_columns && ws.ws_row == visual->term_rows)
+        return 0;
+    visual->term_columns = ws.ws_col;
+    visual->term_rows = ws.ws_row;
+
+    /* Room for the borders, the status line and the few lines printed above the box. */
+    int max_columns = (ws.ws_col - 4) / 2;
+    int max_rows = ws.ws_row - 8;
+    if (max_columns > VISUAL_MAX_COLUMNS)
+        max_columns = VISUAL_MAX_COLUMNS;
+    if (max_rows > VISUAL_MAX_ROWS)
+        max_rows = VISUAL_MAX_ROWS;
+    if (max_columns < 1)
+        max_columns = 1;
+    if (max_rows < 1)
+        max_rows = 1;
+
+    int columns = max_columns;
+    int rows = round(columns / visual->aspect);
+    if (rows > max_rows) {
+        rows = max_rows;
+        columns = round(rows * visual->aspect);
+    }
+    visual->columns = columns < 1 ? 1 : columns > max_columns ? max_columns : columns;
+    visual->rows = rows < 1 ? 1 : rows;
+    return 1;
+}
+
+/*
+ * Works out the glyph of every cell of the box into `cells` from the samples
+ * counted in the finer grid of `visual`, marking the cells inside the limits.
+ */
+static void compose(EVisual *visual, unsigned char cells[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS],
+    int x_min, int y_min, int x_max, int y_max)
+{
+    static uint32_t sums[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    static unsigned char inside[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    memset(sums, 0, sizeof(sums));
+    memset(inside, 0, sizeof(inside));
+
+    int column_min = bin(x_min, visual->x_min, visual->x_max, VISUAL_MAX_COLUMNS);
+    int column_max = bin(x_max, visual->x_min, visual->x_max, VISUAL_MAX_COLUMNS);
+    int row_min = bin(y_min, visual->y_min, visual->y_max, VISUAL_MAX_ROWS);
+    int row_max = bin(y_max, visual->y_min, visual->y_max, VISUAL_MAX_ROWS);
+
+    for (int i = 0; i < VISUAL_MAX_ROWS; i++) {
+        int row = i * visual->rows / VISUAL_MAX_ROWS;
+        int in_rows = i >= row_min && i <= row_max;
+        for (int j = 0; j < VISUAL_MAX_COLUMNS; j++) {
+            int column = j * visual->columns / VISUAL_MAX_COLUMNS;
+            sums[row][column] += visual->counts[i][j];
+            if (in_rows && j >= column_min && j <= column_max)
+                inside[row][column] = 1;
+        }
+    }
+
+    int finger_row = visual->finger_row * visual->rows / VISUAL_MAX_ROWS;
+    int finger_column = visual->finger_column * visual->columns / VISUAL_MAX_COLUMNS;
+    for (int i = 0; i < visual->rows; i++) {
+        for (int j = 0; j < visual->columns; j++) {
+            if (visual->samples && i == finger_row && j == finger_column)
+                cells[i][j] = VISUAL_FINGER;
+            else if (sums[i][j] >= VISUAL_MANY_SAMPLES)
+                cells[i][j] = VISUAL_MANY;
+            else if (sums[i][j])
+                cells[i][j] = VISUAL_FEW;
+            else
+                cells[i][j] = inside[i][j] ? VISUAL_INSIDE : VISUAL_EMPTY;
+        }
+    }
+}
+
+/*
+ * Appends the whole box of `visual` with the `cells` and the status line.
+ * The cursor ends up on the line below the status line.
+ */
+static void append_box(EVisual *visual, unsigned char cells[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS])
+{
+    append(visual, " \x1b[1;36m+\x1b[0;32m");
+    for (int j = 0; j < visual->columns; j++)
+        append(visual, "--");
+    append(visual, "\x1b[1;36m+\n");
+
+    for (int i = 0; i < visual->rows; i++) {
+        append(visual, " \x1b[0;32m|");
+        for (int j = 0; j < visual->columns; j++) {
+            append(visual, "%s", glyphs[cells[i][j]]);
+            visual->shown[i][j] = cells[i][j];
+        }
+        append(visual, "\x1b[0;32m|\n");
+    }
+
+    append(visual, " \x1b[1;36m+\x1b[0;32m");
+    for (int j = 0; j < visual->columns; j++)
+        append(visual, "--");
+    append(visual, "\x1b[1;36m+\n");
+    append(visual, "\x1b[K%s\x1b[;m\n", visual->status);
+}
+
+/*
+ * Initializes the `visual` for the range of the event `fd` and draws the empty box.
+ */
+int LVisualInit(EVisual *visual, int fd)
+{
+    memset(visual, 0, sizeof(*visual));
+
+    int x_resolution = 0, y_resolution = 0;
+    if (probe_axis(fd, ABS_X, &visual->x_min, &visual->x_max, &x_resolution)
+        && probe_axis(fd, ABS_MT_POSITION_X, &visual->x_min, &visual->x_max, &x_resolution)) {
+        visual->x_min = 0;
+        visual->x_max = 65535;
+    }
+    if (probe_axis(fd, ABS_Y, &visual->y_min, &visual->y_max, &y_resolution)
+        && probe_axis(fd, ABS_MT_POSITION_Y, &visual->y_min, &visual->y_max, &y_resolution)) {
+        visual->y_min = 0;
+        visual->y_max = 65535;
+    }
+
+    /* The resolution gives the real shape of the touchpad, if the device knows it. */
+    double width = visual->x_max - visual->x_min, height = visual->y_max - visual->y_min;
+    if (x_resolution > 0 && y_resolution > 0) {
+        width /= x_resolution;
+        height /= y_resolution;
+    }
+    visual->aspect = width / height;
+    if (visual->aspect > 3)
+        visual->aspect = 3;
+    else if (visual->aspect < 1.0 / 3)
+        visual->aspect = 1.0 / 3;
+
+    layout(visual);
+    snprintf(visual->status, sizeof(visual->status), " \x1b[1;36m=> \x1b[1;37mWaiting for input...");
+
+    static unsigned char cells[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    compose(visual, cells, visual->x_max, visual->y_max, visual->x_min, visual->y_min);
+    append(visual, "\x1b[?7l");
+    append_box(visual, cells);
+    append(visual, "\x1b[?7h");
+    return flush(visual);
+}
+
+/*
+ * Counts the sample at `x`, `y` and makes it the finger.
+ */
+void LVisualSample(EVisual *visual, int x, int y)
+{
+    int row = bin(y, visual->y_min, visual->y_max, VISUAL_MAX_ROWS);
+    int column = bin(x, visual->x_min, visual->x_max, VISUAL_MAX_COLUMNS);
+    visual->counts[row][column]++;
+    visual->finger_row = row;
+    visual->finger_column = column;
+    visual->samples++;
+    visual->dirty = 1;
+}
+
+/*
+ * Redraws the cells of the `visual` that changed since the last draw, with the limits
+ * `x_min`, `y_min` - `x_max`, `y_max` and their `coverage` in percent, in a single write.
+ * Does nothing if there is no new sample.
+ */
+int LVisualDraw(EVisual *visual, int x_min, int y_min, int x_max, int y_max, int coverage)
+{
+    if (!visual->dirty)
+        return EXIT_SUCCESS;
+    visual->dirty = 0;
+
+    /* Lines of the box and the status line above the cursor. */
+    int height = visual->rows + 3;
+    int resized = layout(visual);
+
+    static unsigned char cells[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    compose(visual, cells, x_min, y_min, x_max, y_max);
+
+    char status[sizeof(visual->status)];
+    snprintf(status, sizeof(status), " \x1b[1;36m=> \x1b[1;37mPress Ctrl + C to end the calibration. \t "
+        "\x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d \x1b[0;32m- \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d "
+        "\x1b[0;32m(\x1b[0;37m%llu \x1b[1;37msamples, \x1b[0;37m%d%% \x1b[1;37mcovered\x1b[0;32m)",
+        x_min, y_min, x_max, y_max, (unsigned long long) visual->samples, coverage);
+
+    /* Long lines are cut instead of wrapped, so the lines can be counted. */
+    append(visual, "\x1b[?7l");
+    if (resized) {
+        append(visual, "\x1b[%dA\x1b[1G\x1b[J", height);
+        strcpy(visual->status, status);
+        append_box(visual, cells);
+    } else {
+        for (int i = 0; i < visual->rows; i++) {
+            for (int j = 0; j < visual->columns; j++) {
+                if (cells[i][j] == visual->shown[i][j])
+                    continue;
+
+                int up = visual->rows - i + 2;
+                append(visual, "\x1b[%dA\x1b[%dG%s\x1b[%dB", up, 3 + 2 * j, glyphs[cells[i][j]], up);
+                visual->shown[i][j] = cells[i][j];
+            }
+        }
+
+        if (strcmp(status, visual->status)) {
+            strcpy(visual->status, status);
+            append(visual, "\x1b[1A\x1b[1G\x1b[K%s\n", visual->status);
+        }
+        append(visual, "\x1b[1G");
+    }
+    append(visual, "\x1b[;m\x1b[?7h");
+    return flush(visual);
+}
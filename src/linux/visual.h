@@ -0,0 +1,94 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _LINUX_VISUAL_H
+#define _LINUX_VISUAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Largest box the visualization draws, in cells of two characters.
+ */
+#define VISUAL_MAX_COLUMNS 96
+#define VISUAL_MAX_ROWS 48
+
+/*
+ * Times per second the visualization is redrawn at most.
+ */
+#define VISUAL_RATE_HZ 60
+
+/*
+ * Size of the buffer a frame of the visualization is composed in.
+ */
+#define VISUAL_BUFFER_SIZE (1 << 17)
+
+/*
+ * Cell glyphs.
+ * - VISUAL_EMPTY = No samples, outside the limits.
+ * - VISUAL_INSIDE = No samples, inside the limits.
+ * - VISUAL_FEW = A few samples.
+ * - VISUAL_MANY = Enough samples.
+ * - VISUAL_FINGER = The latest sample.
+ */
+#define VISUAL_EMPTY 0
+#define VISUAL_INSIDE 1
+#define VISUAL_FEW 2
+#define VISUAL_MANY 3
+#define VISUAL_FINGER 4
+
+/*
+ * Struct that holds the calibration visualization.
+ * The box covers the whole range of the device and is scaled to the terminal.
+ */
+typedef struct {
+    int x_min, x_max;
+    int y_min, y_max;
+    double aspect;
+
+    int columns, rows;
+    int term_columns, term_rows;
+
+    uint32_t counts[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    unsigned char shown[VISUAL_MAX_ROWS][VISUAL_MAX_COLUMNS];
+    uint64_t samples;
+    int finger_column, finger_row;
+    int dirty;
+
+    char status[256];
+    char buffer[VISUAL_BUFFER_SIZE];
+    size_t length;
+} EVisual;
+
+/*
+ * Initializes the `visual` for the range of the event `fd` and draws the empty box.
+ */
+int LVisualInit(EVisual *visual, int fd);
+
+/*
+ * Counts the sample at `x`, `y` and makes it the finger.
+ */
+void LVisualSample(EVisual *visual, int x, int y);
+
+/*
+ * Redraws the cells of the `visual` that changed since the last draw, with the limits
+ * `x_min`, `y_min` - `x_max`, `y_max` and their `coverage` in percent, in a single write.
+ * Does nothing if there is no new sample.
+ */
+int LVisualDraw(EVisual *visual, int x_min, int y_min, int x_max, int y_max, int coverage);
+
+#endif /* _LINUX_VISUAL_H */
@@ -0,0 +1,231 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "linux/correction.h"
+
+#include "print.h"
+#include "transform.h"
+
+/*
+ * Device area and output rectangle the mappings are checked on.
+ */
+#define X_MIN 100
+#define X_MAX 1100
+#define Y_MIN 50
+#define Y_MAX 650
+static const ERect target = {100, 50, 1920, 1080};
+
+/*
+ * Count of failed checks.
+ */
+static int failures = 0;
+
+/*
+ * Counts a failed check and tells which one it was.
+ */
+#define CHECK(condition, fmt, args...) { if (!(condition)) { failures++; ERRLN(fmt, ##args); } }
+
+/*
+ * Returns the output position of the normalized position `u`, `v` on the target, clamped like a transform does.
+ */
+static EPoint expected_point(double u, double v)
+{
+    double scale = 1 << TRANSFORM_SUBPIXEL_BITS;
+    double x = (target.x + u * target.width) * scale, y = (target.y + v * target.height) * scale;
+    double max_x = (target.x + target.width) * scale - 1, max_y = (target.y + target.height) * scale - 1;
+    EPoint point = {(int32_t) lround(x < max_x ? x : max_x), (int32_t) lround(y < max_y ? y : max_y)};
+    return point;
+}
+
+/*
+ * Checks that every orientation, with and without mirror, maps the corners and a point inside where they belong.
+ */
+static void test_orientations(void)
+{
+    static const int orientations[] = {0, 90, 180, 270};
+    static const double points[][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}, {0.25, 0.75}};
+    for (int i = 0; i < 4; i++) {
+        for (int mirror = 0; mirror < 2; mirror++) {
+            ETransform transform;
+            CHECK(!TBuildTransform(&transform, X_MIN, X_MAX, Y_MIN, Y_MAX, target, orientations[i], mirror),
+                "Couldn't build the transform of \x1b[0;37m%d\x1b[1;37m degrees.", orientations[i]);
+
+            for (int j = 0; j < (int) (sizeof(points) / sizeof(points[0])); j++) {
+                double u = points[j][0], v = points[j][1];
+
+                /* Rotated clockwise, then flipped horizontally. */
+                double ou = u, ov = v;
+                switch (orientations[i]) {
+                    case 90: ou = 1 - v, ov = u; break;
+                    case 180: ou = 1 - u, ov = 1 - v; break;
+                    case 270: ou = v, ov = 1 - u; break;
+                }
+                if (mirror)
+                    ou = 1 - ou;
+
+                int x = (int) lround(X_MIN + u * (X_MAX - X_MIN)), y = (int) lround(Y_MIN + v * (Y_MAX - Y_MIN));
+                EPoint point = TApplyTransform(&transform, x, y);
+                EPoint expected = expected_point(ou, ov);
+                CHECK(abs(point.x - expected.x) <= 1 && abs(point.y - expected.y) <= 1,
+                    "Mapped \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m at \x1b[0;37m%d\x1b[1;37m degrees%s to \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m instead of \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m.",
+                    x, y, orientations[i], mirror ? " mirrored" : "", point.x, point.y, expected.x, expected.y);
+            }
+        }
+    }
+
+    ETransform transform;
+    CHECK(TBuildTransform(&transform, X_MIN, X_MAX, Y_MIN, Y_MAX, target, 45, 0),
+        "Built a transform of \x1b[0;37m45\x1b[1;37m degrees.");
+}
+
+/*
+ * Checks that a homography maps the touched corners to the corners of the target.
+ */
+static void test_homography(ETransform *transform)
+{
+    /* A quadrilateral that is far from a rectangle, so the projective matrix is used. */
+    static const double quad[4][2] = {{150, 80}, {1050, 140}, {1000, 620}, {120, 560}};
+    static const double corners[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    double h[9];
+    CHECK(!TSolveHomography(quad, corners, h), "Couldn't solve the homography of the corners.");
+    CHECK(!TBuildProjectiveTransform(transform, h, target, X_MIN, X_MAX, Y_MIN, Y_MAX),
+        "Couldn't build the projective transform.");
+    CHECK(transform->projective, "The corners were mapped with the affine matrix.");
+
+    for (int i = 0; i < 4; i++) {
+        EPoint point = TApplyTransform(transform, (int) quad[i][0], (int) quad[i][1]);
+        EPoint expected = expected_point(corners[i][0], corners[i][1]);
+        CHECK(abs(point.x - expected.x) <= 1 && abs(point.y - expected.y) <= 1,
+            "Mapped corner \x1b[0;37m%d\x1b[1;37m to \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m instead of \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m.",
+            i, point.x, point.y, expected.x, expected.y);
+    }
+}
+
+/*
+ * Checks that inverting the output positions of `transform` gives back the device positions they came from.
+ */
+static void test_inverse(const ETransform *transform, const char *name)
+{
+    int checked = 0;
+    for (int y = Y_MIN + 60; y < Y_MAX; y += 97) {
+        for (int x = X_MIN + 90; x < X_MAX; x += 131) {
+            /* Positions clamped to the edge of the target can't be told apart anymore. */
+            EPoint point = TApplyTransform(transform, x, y);
+            if (point.x <= transform->min_x || point.x >= transform->max_x || point.y <= transform->min_y || point.y >= transform->max_y)
+                continue;
+
+            double ix, iy;
+            checked++;
+            CHECK(!TInvertTransform(transform, point.x, point.y, &ix, &iy), "Couldn't invert the %s transform.", name);
+
+            /* The output is rounded to 1/256 of a pixel, which is far less than a device unit here. */
+            CHECK(fabs(ix - x) < 0.5 && fabs(iy - y) < 0.5,
+                "Inverted the %s transform at \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m to \x1b[0;37m%.2f\x1b[1;32mx\x1b[0;37m%.2f\x1b[1;37m.",
+                name, x, y, ix, iy);
+        }
+    }
+    CHECK(checked > 20, "Only \x1b[0;37m%d\x1b[1;37m positions of the %s transform were inside the target.", checked, name);
+}
+
+/*
+ * Checks that the correction table moves the positions at its nodes by their displacement,
+ * between them by the average of the two and off the table by the one of its edge.
+ */
+static void test_correction(void)
+{
+    enum { COLUMNS = 4, ROWS = 3 };
+    ECorrectionHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORRECTION_MAGIC, sizeof(header.magic));
+    header.version = CORRECTION_VERSION;
+    header.header_size = sizeof(header);
+    header.columns = COLUMNS;
+    header.rows = ROWS;
+    header.x_min = X_MIN;
+    header.x_max = X_MAX;
+    header.y_min = Y_MIN;
+    header.y_max = Y_MAX;
+
+    ECorrectionNode nodes[COLUMNS * ROWS];
+    for (int i = 0; i < ROWS; i++) {
+        for (int j = 0; j < COLUMNS; j++)
+            nodes[i * COLUMNS + j] = (ECorrectionNode) {.dx = 10 * j - 7 * i, .dy = -4 * j + 12 * i + 3};
+    }
+
+    ECorrection correction;
+    CHECK(!LCorrectionInit(&correction, &header, nodes), "Couldn't set up the correction table.");
+
+    for (int i = 0; i < ROWS; i++) {
+        for (int j = 0; j < COLUMNS; j++) {
+            int node_x = X_MIN + (X_MAX - X_MIN) * j / (COLUMNS - 1), node_y = Y_MIN + (Y_MAX - Y_MIN) * i / (ROWS - 1);
+            const ECorrectionNode *node = &nodes[i * COLUMNS + j];
+            int x = node_x, y = node_y;
+            LCorrect(&correction, &x, &y);
+            CHECK(x == node_x + node->dx && y == node_y + node->dy,
+                "Corrected node \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m by \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m instead of \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m.",
+                j, i, x - node_x, y - node_y, node->dx, node->dy);
+
+            if (j == COLUMNS - 1)
+                continue;
+
+            /* Halfway to the next node in the row, where the interpolation is the plain average. */
+            int next_x = X_MIN + (X_MAX - X_MIN) * (j + 1) / (COLUMNS - 1);
+            x = (node_x + next_x) / 2, y = node_y;
+            int mid_x = x;
+            LCorrect(&correction, &x, &y);
+            double dx = (node[0].dx + node[1].dx) / 2.0, dy = (node[0].dy + node[1].dy) / 2.0;
+            CHECK(fabs(x - mid_x - dx) <= 1 && fabs(y - node_y - dy) <= 1,
+                "Corrected between nodes \x1b[0;37m%d\x1b[1;37m and \x1b[0;37m%d\x1b[1;37m of row \x1b[0;37m%d\x1b[1;37m by \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m instead of \x1b[0;37m%.1f\x1b[1;32mx\x1b[0;37m%.1f\x1b[1;37m.",
+                j, j + 1, i, x - mid_x, y - node_y, dx, dy);
+        }
+    }
+
+    int x = X_MIN - 500, y = Y_MAX + 500;
+    LCorrect(&correction, &x, &y);
+    const ECorrectionNode *corner = &nodes[(ROWS - 1) * COLUMNS];
+    CHECK(x == X_MIN - 500 + corner->dx && y == Y_MAX + 500 + corner->dy,
+        "Corrected a position off the table by \x1b[0;37m%d\x1b[1;32mx\x1b[0;37m%d\x1b[1;37m instead of the edge.",
+        x - (X_MIN - 500), y - (Y_MAX + 500));
+}
+
+int main(int argc, char **argv)
+{
+    PRINTLN("---=====Transform=====---");
+    test_orientations();
+
+    ETransform affine, projective;
+    TBuildTransform(&affine, X_MIN, X_MAX, Y_MIN, Y_MAX, target, 90, 1);
+    test_inverse(&affine, "affine");
+    test_homography(&projective);
+    test_inverse(&projective, "projective");
+
+    PRINTLN("---=====Correction====---");
+    test_correction();
+
+    if (failures) {
+        ERRLN("\x1b[0;37m%d\x1b[1;37m checks failed.", failures);
+        return EXIT_FAILURE;
+    }
+    SUCCESSLN("All checks passed.");
+    return EXIT_SUCCESS;
+}
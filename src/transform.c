@@ -0,0 +1,309 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+
+#include "transform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*
+ * Sets the clamping limits of `transform` to the `target` rectangle.
+ */
+static void set_limits(ETransform *transform, ERect target)
+{
+    transform->min_x = target.x << TRANSFORM_SUBPIXEL_BITS;
+    transform->max_x = ((target.x + target.width) << TRANSFORM_SUBPIXEL_BITS) - 1;
+    transform->min_y = target.y << TRANSFORM_SUBPIXEL_BITS;
+    transform->max_y = ((target.y + target.height) << TRANSFORM_SUBPIXEL_BITS) - 1;
+}
+
+/*
+ * Sets the fixed-point matrix of `transform` from the rows of the normalized output position
+ * and the clamping limits from the `target` rectangle.
+ */
+static void set_affine(ETransform *transform, const double row_x[3], const double row_y[3], ERect target)
+{
+    /* The constant terms carry half a sub-pixel so the shift rounds to the nearest one. */
+    double scale = (double) (1 << TRANSFORM_SUBPIXEL_BITS) * (1 << TRANSFORM_SHIFT);
+    double width = target.width * scale, height = target.height * scale;
+    transform->projective = 0;
+    transform->a = llround(row_x[0] * width);
+    transform->b = llround(row_x[1] * width);
+    transform->c = llround(row_x[2] * width + target.x * scale) + (1 << (TRANSFORM_SHIFT - 1));
+    transform->d = llround(row_y[0] * height);
+    transform->e = llround(row_y[1] * height);
+    transform->f = llround(row_y[2] * height + target.y * scale) + (1 << (TRANSFORM_SHIFT - 1));
+    set_limits(transform, target);
+}
+
+/*
+ * Builds the `transform` that maps the device area from `x_min`, `y_min` to `x_max`, `y_max`
+ * onto the `target` rectangle.
+ * `orientation` rotates clockwise by 0, 90, 180 or 270 degrees and `mirror` flips horizontally after that.
+ */
+int TBuildTransform(ETransform *transform, int x_min, int x_max, int y_min, int y_max,
+    ERect target, int orientation, int mirror)
+{
+    double x_range = x_max != x_min ? x_max - x_min : 1;
+    double y_range = y_max != y_min ? y_max - y_min : 1;
+
+    /* u = su * x + tu and v = sv * y + tv are the normalized device position. */
+    double su = 1.0 / x_range, tu = -x_min / x_range;
+    double sv = 1.0 / y_range, tv = -y_min / y_range;
+
+    /* Each row is the normalized output position as a * x + b * y + c. */
+    double row_x[3], row_y[3];
+    switch (orientation) {
+        case 0:
+            row_x[0] = su, row_x[1] = 0, row_x[2] = tu;
+            row_y[0] = 0, row_y[1] = sv, row_y[2] = tv;
+            break;
+        case 90:
+            row_x[0] = 0, row_x[1] = -sv, row_x[2] = 1 - tv;
+            row_y[0] = su, row_y[1] = 0, row_y[2] = tu;
+            break;
+        case 180:
+            row_x[0] = -su, row_x[1] = 0, row_x[2] = 1 - tu;
+            row_y[0] = 0, row_y[1] = -sv, row_y[2] = 1 - tv;
+            break;
+        case 270:
+            row_x[0] = 0, row_x[1] = sv, row_x[2] = tv;
+            row_y[0] = -su, row_y[1] = 0, row_y[2] = 1 - tu;
+            break;
+        default:
+            return EXIT_FAILURE;
+    }
+
+    if (mirror) {
+        row_x[0] = -row_x[0];
+        row_x[1] = -row_x[1];
+        row_x[2] = 1 - row_x[2];
+    }
+
+    set_affine(transform, row_x, row_y, target);
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Parses the nine comma separated coefficients of the 3x3 matrix in `spec` into `h`, row by row.
+ */
+int TParseHomography(const char *spec, double h[9])
+{
+    const char *p = spec;
+    for (int i = 0; i < 9; i++) {
+        char *end;
+        h[i] = strtod(p, &end);
+        if (end == p || !isfinite(h[i]))
+            return EXIT_FAILURE;
+
+        p = end;
+        if (i < 8 && *p++ != ',')
+            return EXIT_FAILURE;
+    }
+
+    return *p == '\0' ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Solves the `n`x`n` linear system `m` with the right-hand side in its last column,
+ * by Gaussian elimination with partial pivoting. The solution is left in `x`.
+ */
+static int solve(double m[8][9], int n, double *x)
+{
+    for (int i = 0; i < n; i++) {
+        int pivot = i;
+        for (int j = i + 1; j < n; j++) {
+            if (fabs(m[j][i]) > fabs(m[pivot][i]))
+                pivot = j;
+        }
+        if (fabs(m[pivot][i]) < 1e-12)
+            return EXIT_FAILURE;
+
+        for (int k = 0; k <= n; k++) {
+            double t = m[i][k];
+            m[i][k] = m[pivot][k];
+            m[pivot][k] = t;
+        }
+        for (int j = i + 1; j < n; j++) {
+            double factor = m[j][i] / m[i][i];
+            for (int k = i; k <= n; k++)
+                m[j][k] -= factor * m[i][k];
+        }
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        double sum = m[i][n];
+        for (int k = i + 1; k < n; k++)
+            sum -= m[i][k] * x[k];
+        x[i] = sum / m[i][i];
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Solves the homography `h` that maps the four points in `from` to the four points in `to`.
+ * `h` is scaled to be positive inside the quadrilateral of `from`, which must be convex.
+ */
+int TSolveHomography(const double from[4][2], const double to[4][2], double h[9])
+{
+    /* The points are moved around their centroid and scaled, device units would make the system ill-conditioned. */
+    double cx = 0, cy = 0, spread = 0;
+    for (int i = 0; i < 4; i++) {
+        cx += from[i][0] / 4;
+        cy += from[i][1] / 4;
+    }
+    for (int i = 0; i < 4; i++)
+        spread += hypot(from[i][0] - cx, from[i][1] - cy) / 4;
+    if (spread <= 0)
+        return EXIT_FAILURE;
+
+    /* The corners have to turn the same way around the quadrilateral. */
+    int turns = 0;
+    for (int i = 0; i < 4; i++) {
+        const double *p = from[i], *q = from[(i + 1) % 4], *r = from[(i + 2) % 4];
+        double cross = (q[0] - p[0]) * (r[1] - q[1]) - (q[1] - p[1]) * (r[0] - q[0]);
+        turns += cross > 0 ? 1 : cross < 0 ? -1 : 0;
+    }
+    if (abs(turns) != 4)
+        return EXIT_FAILURE;
+
+    double m[8][9];
+    memset(m, 0, sizeof(m));
+    for (int i = 0; i < 4; i++) {
+        double x = (from[i][0] - cx) / spread, y = (from[i][1] - cy) / spread;
+        double u = to[i][0], v = to[i][1];
+        double row_u[9] = {x, y, 1, 0, 0, 0, -x * u, -y * u, u};
+        double row_v[9] = {0, 0, 0, x, y, 1, -x * v, -y * v, v};
+        memcpy(m[2 * i], row_u, sizeof(row_u));
+        memcpy(m[2 * i + 1], row_v, sizeof(row_v));
+    }
+
+    double n[9];
+    if (solve(m, 8, n))
+        return EXIT_FAILURE;
+    n[8] = 1;
+
+    /* Undoes the normalization: h = n * T with T the translation and scaling of the points. */
+    for (int i = 0; i < 3; i++) {
+        h[3 * i] = n[3 * i] / spread;
+        h[3 * i + 1] = n[3 * i + 1] / spread;
+        h[3 * i + 2] = n[3 * i + 2] - (n[3 * i] * cx + n[3 * i + 1] * cy) / spread;
+    }
+
+    /* At the centroid the last row is the one of the normalized matrix, which is 1. */
+    for (int i = 0; i < 4; i++) {
+        if (h[6] * from[i][0] + h[7] * from[i][1] + h[8] <= 0)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Steps the device area is sampled in on each axis to find the error of the affine matrix.
+ */
+#define AFFINE_SAMPLES 8
+
+/*
+ * Returns the largest distance in pixels between mapping the device area from `x_min`, `y_min` to `x_max`, `y_max`
+ * through the homography `h` onto the `target` rectangle and through the affine part of `h`.
+ */
+double THomographyAffineError(const double h[9], ERect target, int x_min, int x_max, int y_min, int y_max)
+{
+    if (fabs(h[8]) < 1e-12)
+        return INFINITY;
+
+    /* Dividing by h[8] instead of the last row is off by the position times their relative difference. */
+    double error = 0;
+    for (int i = 0; i <= AFFINE_SAMPLES; i++) {
+        for (int j = 0; j <= AFFINE_SAMPLES; j++) {
+            double x = x_min + (double) (x_max - x_min) * i / AFFINE_SAMPLES;
+            double y = y_min + (double) (y_max - y_min) * j / AFFINE_SAMPLES;
+            double w = h[6] * x + h[7] * y + h[8];
+            if (w * h[8] <= 0)
+                return INFINITY;
+
+            double scale = fabs(1 / h[8] - 1 / w);
+            double error_x = fabs(h[0] * x + h[1] * y + h[2]) * target.width * scale;
+            double error_y = fabs(h[3] * x + h[4] * y + h[5]) * target.height * scale;
+            error = fmax(error, fmax(error_x, error_y));
+        }
+    }
+    return error;
+}
+
+/*
+ * Builds the `transform` that maps device units through the homography `h`
+ * onto the `target` rectangle, where 0, 0 - 1, 1 of the homography is the whole rectangle.
+ * Falls back to the affine matrix if it stays within `TRANSFORM_AFFINE_ERROR` of `h`
+ * over the device area from `x_min`, `y_min` to `x_max`, `y_max`.
+ */
+int TBuildProjectiveTransform(ETransform *transform, const double h[9], ERect target,
+    int x_min, int x_max, int y_min, int y_max)
+{
+    if (fabs(h[8]) < 1e-12 && fabs(h[6]) < 1e-12 && fabs(h[7]) < 1e-12)
+        return EXIT_FAILURE;
+
+    /* Corners taken by hand always have a little perspective, it only matters once it moves the cursor. */
+    if (THomographyAffineError(h, target, x_min, x_max, y_min, y_max) <= TRANSFORM_AFFINE_ERROR) {
+        double row_x[3] = {h[0] / h[8], h[1] / h[8], h[2] / h[8]};
+        double row_y[3] = {h[3] / h[8], h[4] / h[8], h[5] / h[8]};
+        set_affine(transform, row_x, row_y, target);
+        return EXIT_SUCCESS;
+    }
+
+    memset(transform, 0, sizeof(*transform));
+    set_limits(transform, target);
+    transform->projective = 1;
+
+    /* The rows are scaled to sub-pixels and moved to the target, the division does the rest. */
+    double scale = 1 << TRANSFORM_SUBPIXEL_BITS;
+    for (int i = 0; i < 3; i++) {
+        transform->p[0][i] = h[i] * target.width * scale + h[6 + i] * target.x * scale;
+        transform->p[1][i] = h[3 + i] * target.height * scale + h[6 + i] * target.y * scale;
+        transform->p[2][i] = h[6 + i];
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Finds the device position `x`, `y` that `transform` maps to the output position `px`, `py`,
+ * without clamping.
+ */
+int TInvertTransform(const ETransform *transform, double px, double py, double *x, double *y)
+{
+    /* Both mappings come down to two linear equations a * x + b * y = c in the device position. */
+    double row_x[3], row_y[3];
+    if (transform->projective) {
+        const double (*p)[3] = transform->p;
+        row_x[0] = p[0][0] - px * p[2][0], row_x[1] = p[0][1] - px * p[2][1], row_x[2] = px * p[2][2] - p[0][2];
+        row_y[0] = p[1][0] - py * p[2][0], row_y[1] = p[1][1] - py * p[2][1], row_y[2] = py * p[2][2] - p[1][2];
+    } else {
+        double scale = 1 << TRANSFORM_SHIFT;
+        row_x[0] = transform->a, row_x[1] = transform->b, row_x[2] = px * scale - transform->c;
+        row_y[0] = transform->d, row_y[1] = transform->e, row_y[2] = py * scale - transform->f;
+    }
+
+    double det = row_x[0] * row_y[1] - row_x[1] * row_y[0];
+    if (fabs(det) < 1e-12)
+        return EXIT_FAILURE;
+
+    *x = (row_x[2] * row_y[1] - row_x[1] * row_y[2]) / det;
+    *y = (row_x[0] * row_y[2] - row_x[2] * row_y[0]) / det;
+    return EXIT_SUCCESS;
+}
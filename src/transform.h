@@ -0,0 +1,148 @@
+/****************************************************************************
+** abstouch-nux - An absolute touchpad input client for GNU/Linux.
+** Copyright (C) 2021  acedron <acedrons@yahoo.co.jp>
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+****************************************************************************/
+#ifndef _TRANSFORM_H
+#define _TRANSFORM_H
+
+#include <stdint.h>
+
+/*
+ * Fractional bits of the transform coefficients and of the output positions.
+ * Positions are in 1/256 of a pixel, `>> TRANSFORM_SUBPIXEL_BITS` gives whole pixels.
+ */
+#define TRANSFORM_SHIFT 16
+#define TRANSFORM_SUBPIXEL_BITS 8
+
+/*
+ * Largest distance in pixels the affine matrix may put a position from the homography it replaces.
+ */
+#define TRANSFORM_AFFINE_ERROR 0.25
+
+/*
+ * Struct that holds a rectangle in output pixels.
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} ERect;
+
+/*
+ * Struct that holds a position in 1/256 of a pixel.
+ */
+typedef struct {
+    int32_t x;
+    int32_t y;
+} EPoint;
+
+/*
+ * Struct that holds a precomputed fixed-point 2x3 affine matrix
+ * from device units to output positions.
+ * If `projective` is set, the 3x3 matrix `p` is used instead, dividing by its last row.
+ */
+typedef struct {
+    int64_t a, b, c;
+    int64_t d, e, f;
+
+    int projective;
+    double p[3][3];
+
+    /* Clamping limits of the output positions. */
+    int32_t min_x, max_x;
+    int32_t min_y, max_y;
+} ETransform;
+
+/*
+ * Builds the `transform` that maps the device area from `x_min`, `y_min` to `x_max`, `y_max`
+ * onto the `target` rectangle.
+ * `orientation` rotates clockwise by 0, 90, 180 or 270 degrees and `mirror` flips horizontally after that.
+ */
+int TBuildTransform(ETransform *transform, int x_min, int x_max, int y_min, int y_max,
+    ERect target, int orientation, int mirror);
+
+/*
+ * Parses the nine comma separated coefficients of the 3x3 matrix in `spec` into `h`, row by row.
+ */
+int TParseHomography(const char *spec, double h[9]);
+
+/*
+ * Solves the homography `h` that maps the four points in `from` to the four points in `to`.
+ * `h` is scaled to be positive inside the quadrilateral of `from`, which must be convex.
+ */
+int TSolveHomography(const double from[4][2], const double to[4][2], double h[9]);
+
+/*
+ * Returns the largest distance in pixels between mapping the device area from `x_min`, `y_min` to `x_max`, `y_max`
+ * through the homography `h` onto the `target` rectangle and through the affine part of `h`.
+ */
+double THomographyAffineError(const double h[9], ERect target, int x_min, int x_max, int y_min, int y_max);
+
+/*
+ * Builds the `transform` that maps device units through the homography `h`
+ * onto the `target` rectangle, where 0, 0 - 1, 1 of the homography is the whole rectangle.
+ * Falls back to the affine matrix if it stays within `TRANSFORM_AFFINE_ERROR` of `h`
+ * over the device area from `x_min`, `y_min` to `x_max`, `y_max`.
+ */
+int TBuildProjectiveTransform(ETransform *transform, const double h[9], ERect target,
+    int x_min, int x_max, int y_min, int y_max);
+
+/*
+ * Finds the device position `x`, `y` that `transform` maps to the output position `px`, `py`,
+ * without clamping.
+ */
+int TInvertTransform(const ETransform *transform, double px, double py, double *x, double *y);
+
+/*
+ * Maps the device position `x`, `y` through the projective matrix of `transform` to a clamped output position.
+ */
+static inline EPoint TApplyProjective(const ETransform *transform, int x, int y)
+{
+    /* Past the horizon of the homography the position is pushed to the edge. */
+    double w = transform->p[2][0] * x + transform->p[2][1] * y + transform->p[2][2];
+    w = w > 1e-9 ? w : 1e-9;
+    double px = (transform->p[0][0] * x + transform->p[0][1] * y + transform->p[0][2]) / w;
+    double py = (transform->p[1][0] * x + transform->p[1][1] * y + transform->p[1][2]) / w;
+    px = px < transform->min_x ? transform->min_x : px;
+    px = px > transform->max_x ? transform->max_x : px;
+    py = py < transform->min_y ? transform->min_y : py;
+    py = py > transform->max_y ? transform->max_y : py;
+
+    EPoint point = {(int32_t) (px + 0.5), (int32_t) (py + 0.5)};
+    return point;
+}
+
+/*
+ * Maps the device position `x`, `y` to a clamped output position.
+ */
+static inline EPoint TApplyTransform(const ETransform *transform, int x, int y)
+{
+    if (transform->projective)
+        return TApplyProjective(transform, x, y);
+
+    int64_t px = (transform->a * x + transform->b * y + transform->c) >> TRANSFORM_SHIFT;
+    int64_t py = (transform->d * x + transform->e * y + transform->f) >> TRANSFORM_SHIFT;
+    px = px < transform->min_x ? transform->min_x : px;
+    px = px > transform->max_x ? transform->max_x : px;
+    py = py < transform->min_y ? transform->min_y : py;
+    py = py > transform->max_y ? transform->max_y : py;
+
+    EPoint point = {(int32_t) px, (int32_t) py};
+    return point;
+}
+
+#endif /* _TRANSFORM_H */